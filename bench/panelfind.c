@@ -0,0 +1,71 @@
+/*
+ * panelfind.c
+ *
+ * time panelfind() against the linear scan of panel[] it replaced, with 10,
+ * 100 and 1000 panels
+ */
+
+#define main irwm_main
+#include "../irwm.c"
+#undef main
+#include "xmock.h"
+
+#define LOOKUPS 1000000
+
+/*
+ * the linear scan
+ */
+int linearfind(Window p, int panelorcontent) {
+	int i;
+
+	for (i = 0; i < toppanels; i++) {
+		if (panelorcontent & PANEL && p == panel[i].panel)
+			return i;
+		if (panelorcontent & CONTENT && p == panel[i].content)
+			return i;
+	}
+
+	return -1;
+}
+
+/*
+ * main
+ */
+int main() {
+	int sizes[] = {10, 100, 1000}, s, n, i, found;
+	XWindowAttributes wa;
+	struct timespec start, end;
+	long hash, linear;
+
+	freopen("/dev/null", "w", stdout);
+	logstream = stdout;
+	memset(&wa, 0, sizeof(wa));
+
+	for (s = 0; s < 3; s++) {
+		n = sizes[s];
+		while (firstpanel != -1)
+			panelremove(MOCKDISPLAY, firstpanel, True);
+		for (i = 0; i < n; i++)
+			paneladd(MOCKDISPLAY, MOCKROOT, 0x700000 + i,
+				&wa, None, strdup("bench"));
+
+		found = 0;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (i = 0; i < LOOKUPS; i++)
+			found += panelfind(0x700000 + i % n, CONTENT) != -1;
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		hash = interval(&start, &end);
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (i = 0; i < LOOKUPS; i++)
+			found += linearfind(0x700000 + i % n, CONTENT) != -1;
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		linear = interval(&start, &end);
+
+		fprintf(stderr, "panelfind %4d panels: ", n);
+		fprintf(stderr, "hash %.1f ns, linear %.1f ns per lookup%s\n",
+			hash * 1000.0 / LOOKUPS, linear * 1000.0 / LOOKUPS,
+			found == 2 * LOOKUPS ? "" : " (MISSING PANELS)");
+	}
+	return 0;
+}
@@ -0,0 +1,135 @@
+/*
+ * restack.c
+ *
+ * count the requests stackapply() makes when switching panels with 50
+ * override windows and raiseoverride on, against raising all of them and then
+ * the panel as before; check that the mirror follows the simulated server,
+ * also when a switch comes before the events of the previous one and when a
+ * program raises one of its override windows and changes whether it is on top
+ * just before a switch
+ */
+
+#define main irwm_main
+#include "../irwm.c"
+#undef main
+#include "xmock.h"
+
+#define PANELS 20
+#define OVERRIDES 50
+#define SWITCHES 1000
+
+/*
+ * a program raises one of its override windows
+ */
+void clientraise(Window w) {
+	int p;
+
+	p = mockposition(w);
+	mockdelete(p);
+	mockinsert(0, w);
+	mocknotify(w);
+}
+
+/*
+ * whether the mirror is the same as the server stack
+ */
+Bool mirrorok() {
+	int i, k;
+
+	k = 0;
+	for (i = stacktop; i != -1; i = stack[i].below, k++)
+		if (k >= mocknum || stack[i].win != mockstack[k])
+			return False;
+	return k == mocknum;
+}
+
+/*
+ * whether the server stack is the wanted one: the ontop override windows, the
+ * others, the roof and the panel
+ */
+Bool orderok(int pn) {
+	int i, k, p, last;
+
+	last = -1;
+	for (k = 1; k >= 0; k--)
+		for (i = overridelast[k]; i != -1; i = override[i].prev) {
+			p = mockposition(override[i].win);
+			if (p <= last)
+				return False;
+			last = p;
+		}
+	p = mockposition(panelroof);
+	return p > last && mockposition(panel[pn].panel) == p + 1;
+}
+
+/*
+ * main
+ */
+int main() {
+	XWindowAttributes wa;
+	XCreateWindowEvent cw;
+	unsigned long before, requests, again;
+	int i, k, pn;
+
+	freopen("/dev/null", "w", stdout);
+	logstream = stdout;
+	raiseoverride = True;
+	memset(&wa, 0, sizeof(wa));
+	memset(&cw, 0, sizeof(cw));
+
+	panelroof = XCreateSimpleWindow(MOCKDISPLAY, MOCKROOT,
+		0, 0, 1, 1, 0, 0, 0);
+	for (i = 0; i < PANELS; i++)
+		paneladd(MOCKDISPLAY, MOCKROOT, 0x700000 + i,
+			&wa, None, strdup("bench"));
+	for (i = 0; i < OVERRIDES; i++) {
+		cw.window = XCreateSimpleWindow(MOCKDISPLAY, MOCKROOT,
+			0, 0, 1, 1, 0, 0, 0);
+		overrideadd(&cw);
+		if (i % 7 == 0)
+			overrideontop(numoverride - 1, True);
+	}
+	mockdrain();
+
+	requests = 0;
+	again = 0;
+	for (k = 0; k < SWITCHES; k++) {
+		if (k % 5 == 0) {
+			clientraise(override[k % numoverride].win);
+			mockdrain();
+		}
+		if (k % 5 == 1) {	/* raise read after the switch */
+			i = k % numoverride;
+			clientraise(override[i].win);
+			overrideontop(i, ! override[i].ontop);
+		}
+		pn = panelnth(k % PANELS);
+
+		before = mockrequests;
+		stackapply(MOCKDISPLAY, pn);
+		requests += mockrequests - before;
+
+		before = mockrequests;
+		stackapply(MOCKDISPLAY, pn);
+		again += mockrequests - before;
+
+		if (k % 5 != 1 && ! orderok(pn)) {
+			fprintf(stderr, "restack: wrong order at switch %d\n",
+				k);
+			return EXIT_FAILURE;
+		}
+		if (k % 2 == 0 || k % 5 == 1)
+			mockdrain();
+		if (mocknumevents == 0 && ! mirrorok()) {
+			fprintf(stderr, "restack: wrong mirror at switch %d\n",
+				k);
+			return EXIT_FAILURE;
+		}
+	}
+
+	fprintf(stderr, "restack %d overrides: ", OVERRIDES);
+	fprintf(stderr, "%.2f requests per switch, %d raising all",
+		(double) requests / SWITCHES, 1 + OVERRIDES);
+	fprintf(stderr, ", %lu repeating a switch\n", again);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+/*
+ * xmock.h
+ *
+ * stand-ins for the Xlib calls irwm makes while managing panels, for running
+ * its functions without an X server; each call counts as a request, and the
+ * stacking order of the top-level windows is simulated so that the requests
+ * of a restack can be counted and their effect checked
+ *
+ * included by the benchmarks after irwm.c, with its main renamed to irwm_main
+ */
+
+/*
+ * the display, only used for its screen, and the root window
+ */
+Screen mockscreen;
+typeof(*(_XPrivDisplay) NULL) mockprivdisplay = {.screens = &mockscreen};
+#define MOCKDISPLAY ((Display *) &mockprivdisplay)
+#define MOCKROOT ((Window) 1)
+
+/*
+ * requests made, kept in the display so that NextRequest() works, and windows
+ * created
+ */
+#define mockrequests (mockprivdisplay.request)
+static Window mockid = 0x900000;
+
+/*
+ * stacking order of the children of root, from the top; the events that the
+ * server would send are queued, to be passed to stacknotify()
+ */
+#define MOCKWINDOWS 20000
+static Window mockstack[MOCKWINDOWS];
+static int mocknum = 0;
+static XEvent mockevents[MOCKWINDOWS];
+static int mocknumevents = 0;
+
+static int mockposition(Window w) {
+	int i;
+	for (i = 0; i < mocknum; i++)
+		if (mockstack[i] == w)
+			return i;
+	return -1;
+}
+static void mockinsert(int p, Window w) {
+	memmove(mockstack + p + 1, mockstack + p,
+		(mocknum - p) * sizeof(Window));
+	mockstack[p] = w;
+	mocknum++;
+}
+static void mockdelete(int p) {
+	memmove(mockstack + p, mockstack + p + 1,
+		(mocknum - p - 1) * sizeof(Window));
+	mocknum--;
+}
+static void mockqueue(XEvent *e) {
+	if (mocknumevents < MOCKWINDOWS)
+		mockevents[mocknumevents++] = *e;
+}
+static void mocknotify(Window w) {
+	XEvent e;
+	int p;
+	memset(&e, 0, sizeof(e));
+	p = mockposition(w);
+	e.type = ConfigureNotify;
+	e.xconfigure.serial = mockrequests;
+	e.xconfigure.event = MOCKROOT;
+	e.xconfigure.window = w;
+	e.xconfigure.above = p + 1 < mocknum ? mockstack[p + 1] : None;
+	mockqueue(&e);
+}
+
+/*
+ * the requests; these definitions take the place of the ones in Xlib
+ */
+Window XCreateSimpleWindow(Display *d, Window parent, int x, int y,
+		unsigned int width, unsigned int height,
+		unsigned int border_width, unsigned long border,
+		unsigned long background) {
+	XEvent e;
+	(void) d; (void) parent; (void) x; (void) y; (void) width;
+	(void) height; (void) border_width; (void) border; (void) background;
+	mockrequests++;
+	mockid++;
+	mockinsert(0, mockid);
+	memset(&e, 0, sizeof(e));
+	e.type = CreateNotify;
+	e.xcreatewindow.serial = mockrequests;
+	e.xcreatewindow.parent = MOCKROOT;
+	e.xcreatewindow.window = mockid;
+	mockqueue(&e);
+	return mockid;
+}
+int XRaiseWindow(Display *d, Window w) {
+	int p;
+	(void) d;
+	mockrequests++;
+	p = mockposition(w);
+	if (p == -1)
+		return 1;
+	mockdelete(p);
+	mockinsert(0, w);
+	mocknotify(w);
+	return 1;
+}
+int XConfigureWindow(Display *d, Window w, unsigned int mask,
+		XWindowChanges *wc) {
+	int p, s;
+	(void) d;
+	mockrequests++;
+	p = mockposition(w);
+	if (p == -1 || ! (mask & CWStackMode))
+		return 1;
+	mockdelete(p);
+	s = mask & CWSibling ? mockposition(wc->sibling) : -1;
+	if (s == -1)
+		mockinsert(wc->stack_mode == Above ? 0 : mocknum, w);
+	else
+		mockinsert(wc->stack_mode == Above ? s : s + 1, w);
+	mocknotify(w);
+	return 1;
+}
+int XSelectInput(Display *d, Window w, long mask) {
+	(void) d; (void) w; (void) mask;
+	return ++mockrequests;
+}
+int XReparentWindow(Display *d, Window w, Window parent, int x, int y) {
+	(void) d; (void) w; (void) parent; (void) x; (void) y;
+	return ++mockrequests;
+}
+int XStoreName(Display *d, Window w, _Xconst char *name) {
+	(void) d; (void) w; (void) name;
+	return ++mockrequests;
+}
+int XDestroyWindow(Display *d, Window w) {
+	int p;
+	(void) d;
+	p = mockposition(w);
+	if (p != -1)
+		mockdelete(p);
+	return ++mockrequests;
+}
+int XMapWindow(Display *d, Window w) {
+	(void) d; (void) w;
+	return ++mockrequests;
+}
+int XUnmapWindow(Display *d, Window w) {
+	(void) d; (void) w;
+	return ++mockrequests;
+}
+int XDeleteProperty(Display *d, Window w, Atom property) {
+	(void) d; (void) w; (void) property;
+	return ++mockrequests;
+}
+int XChangeProperty(Display *d, Window w, Atom property, Atom type,
+		int format, int mode, _Xconst unsigned char *data,
+		int nelements) {
+	(void) d; (void) w; (void) property; (void) type; (void) format;
+	(void) mode; (void) data; (void) nelements;
+	return ++mockrequests;
+}
+int XSetInputFocus(Display *d, Window focus, int revert, Time time) {
+	(void) d; (void) focus; (void) revert; (void) time;
+	return ++mockrequests;
+}
+int XClearArea(Display *d, Window w, int x, int y,
+		unsigned int width, unsigned int height, Bool exposures) {
+	(void) d; (void) w; (void) x; (void) y; (void) width; (void) height;
+	(void) exposures;
+	return ++mockrequests;
+}
+int XFlush(Display *d) {
+	(void) d;
+	return 1;
+}
+
+/*
+ * pass the queued events to irwm
+ */
+void mockdrain() {
+	int i;
+	for (i = 0; i < mocknumevents; i++)
+		stacknotify(&mockevents[i], MOCKROOT);
+	mocknumevents = 0;
+}
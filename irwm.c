@@ -5,7 +5,7 @@
  *
  * gcc -I/usr/X11R6/include -Wall -Wextra \
  * -DLIRC -DXFT -I/usr/include/freetype2 \
- * -L/usr/X11R6/lib irwm.c -lX11 -llirc_client -lXft -o irwm
+ * -L/usr/X11R6/lib irwm.c -lX11 -llirc_client -lXft -lpthread -o irwm
  *
  * xinit ./irwm
  * startx ./irwm
@@ -16,18 +16,21 @@
  *
  *   alt-right		next panel
  *   alt-left		previous panel
+ *   alt-down		last used panel
  *   alt-tab		panel list
  *   ctrl-tab		program list
- * 			in lists: up/down/return/escape
+ * 			in lists: up/down/pageup/pagedown/return/escape
  *			only in panel list: c = close panel
  *   ctrl-shift-l	print panels in the log file
+ *   ctrl-shift-s	print latency statistics in the log file
  *   ctrl-shift-tab	quit
  *
- * lirc, or ClientMessage of message_type "IRWM" to the root window:
+ * lirc (-l), or ClientMessage of message_type "IRWM" to the root window:
  *
  *   NOCOMMAND		nop
  *   NEXTPANEL		switch to next panel
  *   PREVPANEL		switch to previous panel
+ *   LASTPANEL		switch to the last used panel
  *   RESTART		restart irwm
  *   RETIRE		quit irwm without quitting X
  *   QUIT		quit irwm
@@ -46,9 +49,14 @@
  *   OKWINDOW		select the current item in the window
  *   KOWINDOW		only in the panel list window: close the current panel
  *   ENDWINDOW		only in the panel list window: move panel at end
+ *   PAGEUPWINDOW	a page up in the window
+ *   PAGEDOWNWINDOW	a page down in the window
+ *   MRUWINDOW		only in the panel list: toggle recently used order
  *
  *   NUMWINDOW(n)	select entry n in the list
  *
+ *   STATS		print latency statistics in the log file
+ *
  * details on configuring and testing lirc are in file lircrd
  */
 
@@ -59,11 +67,7 @@
  * properties like the title (XGetWMName), class (XGetClassHint) or program
  * (XGetCommand)
  *
- * window names are assumed to be ascii
- *
  * allow arguments to programs in config file
- *
- * select also property change events to update window names when they change
  */
 
 /*
@@ -75,8 +79,12 @@
  *
  * always map content first and then panel; unmap in reverse order
  *
- * alternative to the lirc client: select(2) on the socket descriptors obtained
- * from ConnectionNumber(dsp) and lirc_init(IRWM, 1)
+ * the main loop waits with epoll(7) on the X connection ConnectionNumber(dsp),
+ * the lirc socket, a signalfd for SIGCHLD and the timerfds; the lirc codes are
+ * decoded in irwm and the resulting commands are queued until the main loop
+ * executes them one at time; the X events already received are
+ * processed in batches, and the other descriptors are only checked between
+ * batches; a timer replaces sleeping, so that the loop is never stalled
  */
 
 /*
@@ -87,12 +95,14 @@
  * drawn by drawprogs(), drawpanel() and drawconfirm(); they all call
  * drawlist() and are called on Expose events on their windows
  *
- * these windows are always present and are always both raised by raiselists()
- * when something changes (map, unmap and destroy event), but are only mapped
- * in response to the commands PROGSWINDOW, PANELWINDOW and QUIT, or when
- * "quit" is selected in the program list; the Boolean variables showprogs,
- * showpanels and showconfirm store whether they are mapped; they are unmapped
- * on commands OKWINDOW and HIDEWINDOW or when another is mapped
+ * these windows are always present and are raised by raiselists() when
+ * something changes (map, unmap and destroy event) if mapped and not already
+ * on top, but are only mapped in response to the commands PROGSWINDOW,
+ * PANELWINDOW and QUIT, or when "quit" is selected in the program list; the
+ * Boolean variables showprogs, showpanels and showconfirm store whether they
+ * should be mapped; they are unmapped on commands OKWINDOW and HIDEWINDOW or
+ * when another is mapped; after each command, showlist() and grabkeyboard()
+ * send requests only if the windows or the keyboard grab have to change
  */
 
 /*
@@ -102,7 +112,8 @@
  * windows; irwm does not reparent them to a panel, but keeps a list of them
  *
  * if the raiseoverride variable is true, irwm raises all such windows every
- * time it enters a panel; this is currently disabled
+ * time it enters a panel, restacking only the ones out of order; this is
+ * currently disabled
  *
  * a typical use of override windows is to implement menus; programs often
  * misplace them too close to the screen border, where parts of them fall
@@ -112,9 +123,11 @@
  * a special case are override windows that are larger or taller than the
  * screen; irwm moves them in a random position that makes them fill the width
  * or the height of the screen, with a preference to aligning them to the
- * horizontal or vertical borders; opening such a menu multiple times allows
- * eventually accessing all its items; the target position is saved to avoid
- * moving them again
+ * horizontal or vertical borders; the target position is saved to avoid
+ * moving them again; it is also remembered by class and size of the window,
+ * so that the menu is moved straight there when opened again, or to its next
+ * part if it is larger than the screen; opening such a menu multiple times
+ * allows accessing all its items
  */
 
 /*
@@ -137,6 +150,11 @@
  * enters the panel under it; this is often the main gedit window, which is
  * already closed
  *
+ * to limit these strings, the windows known to be destroyed, either from a
+ * DestroyNotify or from a BadWindow error, are kept in a set of tombstones;
+ * no request is sent for them, and the panels containing them are removed all
+ * together at the end of the batch of events, before entering another panel
+ *
  * the error handler is also needed because irwm prints the name of atoms it
  * receives as window manager hints; a program may send arbitrary integers, not
  * representing any atom; the X server send back an error when asked for their
@@ -144,19 +162,29 @@
  * such cases
  */
 
+#define _GNU_SOURCE
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <signal.h>
 #include <sys/wait.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <X11/Xlib.h>
 #include <X11/Xatom.h>
 #include <X11/Xutil.h>
 #include <X11/keysym.h>
 #include <X11/Xproto.h>
 #include <X11/cursorfont.h>
+#include "irwm.h"
 #ifdef LIRC
 #include <lirc_client.h>
 #endif
@@ -176,106 +204,80 @@
 #define XFTFONT "Arial-15:bold"
 
 /*
- * commands
+ * the log: stdout, the stream of the asynchronous log, or NULL when there is
+ * only the binary trace; then nothing is formatted nor flushed
  */
-#define NOCOMMAND      0	/* no command */
-#define NEXTPANEL      1	/* switch to next panel */
-#define PREVPANEL      2	/* switch to previous panel */
-#define RESTART        3	/* restart irwm */
-#define RETIRE         4	/* retire irwm */
-#define QUIT           5	/* quit irwm */
-#define LOGLIST        6	/* print panels in the log file */
-#define POSITIONFIX    7	/* toggle: fix position of override windows */
-#define RESIZE         8	/* resize the current panel */
-#define PASSKEYS       9	/* pass keystrokes to the window or stop it */
-
-#define PANELWINDOW   10	/* show the panel list window */
-#define PROGSWINDOW   11	/* show the programs window */
-#define CONFIRMWINDOW 12	/* show the quit confirm dialog */
-
-#define UPWINDOW      20	/* up in the window */
-#define DOWNWINDOW    21	/* down in the window */
-#define HIDEWINDOW    22	/* hide both windows */
-#define OKWINDOW      23	/* select the current item in the window */
-#define KOWINDOW      24	/* close currently selected panel */
-#define ENDWINDOW     25	/* move currently active panel at the end */
-
-#define NUMWINDOW(n)  (100 + (n))	/* select entry n in the window */
+FILE *logstream;
+#define logprintf(...) \
+	(logstream == NULL ? 0 : fprintf(logstream, __VA_ARGS__))
+void logflush() {
+	if (logstream != NULL)
+		fflush(logstream);
+}
 
 /*
- * commands, their names and keystrokes
+ * the keystroke dispatch table: for each keycode, the commands bound to it
+ * with their modifiers and the program list shortcut; built from
+ * commandstring[] and the shortcuts at startup, rebuilt when the keyboard
+ * mapping changes
  */
+#define MAXKEYCODES 256
+#define MAXBINDINGS 8
 struct {
-	int command;	char *string;	int keysym;	unsigned modifier;
-} commandstring[] = {
-	{NOCOMMAND,	"NOCOMMAND",	XK_VoidSymbol,	0},
-	{NEXTPANEL,	"NEXTPANEL",	XK_Right,	Mod1Mask},
-	{PREVPANEL,	"PREVPANEL",	XK_Left,	Mod1Mask},
-	{RESTART,	"RESTART", XK_Tab, ControlMask | ShiftMask | Mod1Mask},
-	{QUIT,		"QUIT",		XK_Tab,	ControlMask | ShiftMask},
-	{LOGLIST,	"LOGLIST",	XK_l,	ControlMask | ShiftMask},
-	{PANELWINDOW,	"PANELWINDOW",	XK_Tab,		Mod1Mask},
-	{PROGSWINDOW,	"PROGSWINDOW",	XK_Tab,		ControlMask},
-	{PASSKEYS,	"PASSKEYS",	XK_Up,		Mod1Mask},
-	{-1,		"ENDGRAB",	XK_VoidSymbol,	0},
-	{RETIRE,	"RETIRE", 	XK_VoidSymbol,  0},
-	{RESIZE,	"RESIZE",	XK_VoidSymbol,  0},
-	{POSITIONFIX,	"POSITIONFIX",	XK_VoidSymbol,	0},
-	{CONFIRMWINDOW, "CONFIRMWINDOW", XK_VoidSymbol, 0},
-	{UPWINDOW,	"UPWINDOW",	XK_Up,		0},
-	{DOWNWINDOW,	"DOWNWINDOW",	XK_Down,	0},
-	{HIDEWINDOW,	"HIDEWINDOW",	XK_Escape,	0},
-	{OKWINDOW,	"OKWINDOW",	XK_Return,	0},
-	{KOWINDOW,	"KOWINDOW",	XK_c,		0},
-	{ENDWINDOW,	"ENDWINDOW",	XK_e,		0},
-	{NUMWINDOW(1),	"NUMWINDOW(1)",	XK_1,		0},
-	{NUMWINDOW(2),	"NUMWINDOW(2)",	XK_2,		0},
-	{NUMWINDOW(3),	"NUMWINDOW(3)",	XK_3,		0},
-	{NUMWINDOW(4),	"NUMWINDOW(4)",	XK_4,		0},
-	{NUMWINDOW(5),	"NUMWINDOW(5)",	XK_5,		0},
-	{NUMWINDOW(6),	"NUMWINDOW(6)",	XK_6,		0},
-	{NUMWINDOW(7),	"NUMWINDOW(7)",	XK_7,		0},
-	{NUMWINDOW(8),	"NUMWINDOW(8)",	XK_8,		0},
-	{NUMWINDOW(9),	"NUMWINDOW(9)",	XK_9,		0},
-	{-1,		NULL,		XK_VoidSymbol,	0},
-	{-1,		NULL,		XK_VoidSymbol,  0}
-};
-char *commandtostring(int command) {
-	int i;
-	for(i = 0; commandstring[i].string; i++)
-		if (commandstring[i].command == command)
-			return commandstring[i].string;
-	if (command >= NUMWINDOW(0)) {
-		if (commandstring[i + 1].string == NULL)
-			commandstring[i + 1].string = malloc(100);
-		sprintf(commandstring[i + 1].string, "NUMWINDOW(%d)", command);
-		return commandstring[i + 1].string;
-	}
-	return "ERROR: no such command";
-}
-int stringtocommand(char *string) {
-	int i;
-	char par;
-	for(i = 0; commandstring[i].string; i++)
-		if (! strcmp(commandstring[i].string, string))
-			return commandstring[i].command;
-	if (sscanf(string, "NUMWINDOW(%d%c", &i, &par) == 2 &&
-	    i >=0 && par == ')')
-		return NUMWINDOW(i);
-	return -1;
+	int numbindings;
+	struct {
+		unsigned modifier;
+		int command;
+	} binding[MAXBINDINGS];
+	int shortcut;
+} keytable[MAXKEYCODES];
+KeyCode commandkeycode[sizeof(commandstring) / sizeof(commandstring[0])];
+
+void keytablebuild(Display *dsp, KeySym *list) {
+	int i, j, n;
+	KeyCode k;
+
+	memset(keytable, 0, sizeof(keytable));	/* shortcut = NOCOMMAND */
+
+	for(i = 0; commandstring[i].string; i++) {
+		commandkeycode[i] = 0;
+		if (commandstring[i].keysym == XK_VoidSymbol)
+			continue;
+		k = XKeysymToKeycode(dsp, commandstring[i].keysym);
+		commandkeycode[i] = k;
+		if (k == 0)
+			continue;
+		n = keytable[k].numbindings;
+		for (j = 0; j < n; j++)
+			if (keytable[k].binding[j].modifier ==
+			    commandstring[i].modifier)
+				break;
+		if (j < n)
+			continue;
+		if (n >= MAXBINDINGS) {
+			logprintf("WARNING: too many bindings for keycode %d\n",
+				k);
+			continue;
+		}
+		keytable[k].binding[n].modifier = commandstring[i].modifier;
+		keytable[k].binding[n].command = commandstring[i].command;
+		keytable[k].numbindings++;
+	}
+
+	for (i = 0; list[i] != XK_VoidSymbol; i++) {
+		k = XKeysymToKeycode(dsp, list[i]);
+		if (k != 0 && keytable[k].shortcut == NOCOMMAND)
+			keytable[k].shortcut = NUMWINDOW(i + 1);
+	}
 }
-int eventtocommand(Display *dsp, XKeyEvent e, KeySym *list) {
+int eventtocommand(XKeyEvent e, Bool shortcuts) {
 	int i;
-	for(i = 0; commandstring[i].string; i++)
-		if (e.keycode == XKeysymToKeycode(dsp, commandstring[i].keysym)
-		    && e.state == commandstring[i].modifier)
-			return commandstring[i].command;
-	if (list == NULL)
+	if (e.keycode >= MAXKEYCODES)
 		return NOCOMMAND;
-	for (list = list, i = 0; *list != XK_VoidSymbol; list++, i++)
-		if (e.keycode == XKeysymToKeycode(dsp, *list))
-			return NUMWINDOW(i + 1);
-	return NOCOMMAND;
+	for (i = 0; i < keytable[e.keycode].numbindings; i++)
+		if (e.state == keytable[e.keycode].binding[i].modifier)
+			return keytable[e.keycode].binding[i].command;
+	return shortcuts ? keytable[e.keycode].shortcut : NOCOMMAND;
 }
 
 /*
@@ -284,14 +286,16 @@ int eventtocommand(Display *dsp, XKeyEvent e, KeySym *list) {
 void grabkeys(Display *dsp, Window root, Bool grab) {
 	int i;
 	for (i = 1; ! ! strcmp(commandstring[i].string, "ENDGRAB"); i++)
-		if (grab)
+		if (commandkeycode[i] == 0)
+			continue;
+		else if (grab)
 			XGrabKey(dsp,
-				XKeysymToKeycode(dsp, commandstring[i].keysym),
+				commandkeycode[i],
 				commandstring[i].modifier,
 				root, False, GrabModeAsync, GrabModeAsync);
 		else if (commandstring[i].command != PASSKEYS)
 			XUngrabKey(dsp,
-				XKeysymToKeycode(dsp, commandstring[i].keysym),
+				commandkeycode[i],
 				commandstring[i].modifier, root);
 }
 
@@ -300,134 +304,639 @@ void grabkeys(Display *dsp, Window root, Bool grab) {
  */
 #define MODULEINCREASE(n, mod, rel) n = ((n) + (mod) + (rel)) % (mod)
 
+/*
+ * mark a call that waits for a reply from the server, to count round trips
+ */
+unsigned long roundtrips = 0;
+#define ROUNDTRIP(call) (roundtrips++, (call))
+
 /*
  * ICCCM atoms
  */
 Atom wm_protocols, wm_state, wm_delete_window;
 Atom net_supported;
 Atom net_client_list, net_client_list_stacking, net_active_window;
+Atom net_wm_name, utf8_string;
 
 /*
  * error handler
  */
-#define Error 0
-#define Reply 1
+#define NoEvent LASTEvent	/* no X event, only other input */
 int handler(Display *d, XErrorEvent *e) {
-	printf("error handler called\n");
+	logprintf("error handler called\n");
 	XPutBackEvent(d, (XEvent *) e);
 	return 0;
 }
 
 /*
- * the lirc client
+ * the trace: a ring of binary records of the last events and commands, written
+ * to the trace file only on LOGLIST, SIGUSR1, a crash and exit; the irwmtrace
+ * program converts it into text; with a trace file, the text log is disabled
  */
-#ifndef LIRC
-int lirc(Window root, Atom irwm, char *lircrc) {
-	(void) root;
-	(void) irwm;
-	(void) lircrc;
-	return EXIT_FAILURE;
+#define TRACESIZE 4096
+struct trace trace[TRACESIZE];
+unsigned long tracecount = 0;
+int tracefd = -1;
+
+/*
+ * add a record to the trace
+ */
+void traceadd(int type, unsigned long serial, Window window, Window other,
+		int detail0, int detail1) {
+	struct trace *t;
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	t = &trace[tracecount % TRACESIZE];
+	t->time = now.tv_sec * 1000000000ULL + now.tv_nsec;
+	t->serial = serial;
+	t->type = type;
+	t->window = window;
+	t->other = other;
+	t->detail[0] = detail0;
+	t->detail[1] = detail1;
+	tracecount++;
+}
+
+/*
+ * add the record of an event to the trace
+ */
+void traceevent(XEvent *e) {
+	XErrorEvent *err;
+	switch (e->type) {
+	case Error:
+		err = &e->xerror;
+		traceadd(Error, err->serial, err->resourceid, None,
+			err->error_code, err->request_code);
+		break;
+	case MapRequest:
+		traceadd(e->type, e->xany.serial, e->xmaprequest.window,
+			e->xmaprequest.parent, 0, 0);
+		break;
+	case ConfigureRequest:
+		traceadd(e->type, e->xany.serial, e->xconfigurerequest.window,
+			e->xconfigurerequest.above,
+			e->xconfigurerequest.width,
+			e->xconfigurerequest.height);
+		break;
+	case ConfigureNotify:
+		traceadd(e->type, e->xany.serial, e->xconfigure.window,
+			e->xconfigure.above,
+			e->xconfigure.width, e->xconfigure.height);
+		break;
+	case CreateNotify:
+		traceadd(e->type, e->xany.serial, e->xcreatewindow.window,
+			e->xcreatewindow.parent,
+			e->xcreatewindow.override_redirect, 0);
+		break;
+	case DestroyNotify:
+		traceadd(e->type, e->xany.serial, e->xdestroywindow.window,
+			e->xdestroywindow.event, 0, 0);
+		break;
+	case ReparentNotify:
+		traceadd(e->type, e->xany.serial, e->xreparent.window,
+			e->xreparent.parent, 0, 0);
+		break;
+	case MapNotify:
+		traceadd(e->type, e->xany.serial, e->xmap.window,
+			e->xmap.event, 0, 0);
+		break;
+	case UnmapNotify:
+		traceadd(e->type, e->xany.serial, e->xunmap.window,
+			e->xunmap.event, e->xunmap.send_event, 0);
+		break;
+	case ClientMessage:
+		traceadd(e->type, e->xany.serial, e->xclient.window,
+			e->xclient.message_type,
+			e->xclient.format == 32 ? e->xclient.data.l[0] : 0,
+			e->xclient.format == 32 ? e->xclient.data.l[1] : 0);
+		break;
+	case KeyPress:
+	case KeyRelease:
+		traceadd(e->type, e->xany.serial, e->xkey.subwindow, None,
+			e->xkey.keycode, e->xkey.state);
+		break;
+	case PropertyNotify:
+		traceadd(e->type, e->xany.serial, e->xproperty.window,
+			e->xproperty.atom, 0, 0);
+		break;
+	case Expose:
+		traceadd(e->type, e->xany.serial, e->xexpose.window, None,
+			e->xexpose.count, 0);
+		break;
+	default:
+		traceadd(e->type, e->xany.serial, e->xany.window, None, 0, 0);
+	}
 }
-#else
-int lirc(Window root, Atom irwm, char *lircrc) {
-	char *displayname;
-	Display *dsp;
-	struct lirc_config *config;
-	char *code, *c;
-	XEvent message;
 
-	printf("lirc client started: ");
-	printf("config file: %s\n", lircrc ? lircrc : "default");
+/*
+ * write the trace to its file, oldest record first; only calls functions that
+ * can be used in a signal handler
+ */
+void tracedump() {
+	uint32_t header[2];
+	unsigned long first, n;
+	ssize_t res;
 
-	displayname = getenv("DISPLAY");
-	dsp = XOpenDisplay(displayname);
-	if (dsp == NULL) {
-		printf("cannot open display: %s\n", displayname);
-		exit(EXIT_FAILURE);
+	if (tracefd == -1)
+		return;
+	n = tracecount < TRACESIZE ? tracecount : TRACESIZE;
+	first = tracecount < TRACESIZE ? 0 : tracecount % TRACESIZE;
+	header[0] = sizeof(struct trace);
+	header[1] = n;
+
+	lseek(tracefd, 0, SEEK_SET);
+	res = write(tracefd, TRACEMAGIC, strlen(TRACEMAGIC));
+	res = write(tracefd, header, sizeof(header));
+	res = write(tracefd, trace + first,
+		(n - first) * sizeof(struct trace));
+	res = write(tracefd, trace, first * sizeof(struct trace));
+	res = ftruncate(tracefd, lseek(tracefd, 0, SEEK_CUR));
+	(void) res;
+}
+
+/*
+ * dump the trace on a crash, then crash
+ */
+void tracecrash(int s) {
+	tracedump();
+	raise(s);
+}
+
+/*
+ * asynchronous log: logstream is a stream that appends to a lock-free
+ * single-producer single-consumer ring, and a thread writes the ring to the log
+ * file; the main loop never waits for the log file, but drops what does not
+ * fit in the ring when the file is too slow
+ */
+#define LOGSIZE (256 * 1024)
+char logring[LOGSIZE];
+atomic_size_t loghead = 0, logtail = 0;
+atomic_ulong logdropped = 0;
+atomic_bool logstopping = False;
+int logfd = -1, logwake = -1;
+pthread_t logthread;
+
+/*
+ * wake the log writer thread
+ */
+void logsignal() {
+	uint64_t one = 1;
+	ssize_t res;
+
+	res = write(logwake, &one, sizeof(one));
+	(void) res;
+}
+
+/*
+ * append a record to the ring; called by the stdio functions on logstream;
+ * the writer only sleeps on an empty ring, so it is woken only when it had
+ * written all the previous records; head is stored before tail is loaded and
+ * the writer does the opposite, sequentially consistent, so that either this
+ * function sees the writer caught up or the writer sees the new head
+ */
+ssize_t logappend(void *cookie, const char *buf, size_t size) {
+	size_t head, tail, pos, part;
+
+	(void) cookie;
+	head = atomic_load_explicit(&loghead, memory_order_relaxed);
+	tail = atomic_load_explicit(&logtail, memory_order_acquire);
+	if (LOGSIZE - (head - tail) < size) {
+		atomic_fetch_add_explicit(&logdropped, 1, memory_order_relaxed);
+		return size;
 	}
 
-	if (lirc_init(IRWM, 1) == -1) {
-		printf("failed lirc_init\n");
-		exit(EXIT_FAILURE);
+	pos = head % LOGSIZE;
+	part = size < LOGSIZE - pos ? size : LOGSIZE - pos;
+	memcpy(logring + pos, buf, part);
+	memcpy(logring, buf + part, size - part);
+	atomic_store(&loghead, head + size);
+	if (atomic_load(&logtail) == head)
+		logsignal();
+	return size;
+}
+
+/*
+ * the log writer thread: write the ring to the file in batches, sleep on the
+ * eventfd when the ring is empty
+ */
+void *logwriter(void *arg) {
+	size_t head, tail, pos, part;
+	unsigned long dropped, reported = 0;
+	uint64_t count;
+	char note[100];
+	ssize_t res;
+
+	(void) arg;
+	while (True) {
+		dropped = atomic_load_explicit(&logdropped,
+			memory_order_relaxed);
+		if (dropped != reported) {
+			sprintf(note, "[%lu log records dropped]\n",
+				dropped - reported);
+			res = write(logfd, note, strlen(note));
+			reported = dropped;
+		}
+
+		head = atomic_load(&loghead);
+		tail = atomic_load_explicit(&logtail, memory_order_relaxed);
+		if (head == tail) {
+			if (atomic_load(&logstopping))
+				break;
+			res = read(logwake, &count, sizeof(count));
+			continue;
+		}
+
+		pos = tail % LOGSIZE;
+		part = head - tail < LOGSIZE - pos ? head - tail : LOGSIZE - pos;
+		res = write(logfd, logring + pos, part);
+		if (res <= 0)
+			res = part;	/* cannot write: discard */
+		atomic_store(&logtail, tail + res);
 	}
+	return NULL;
+}
 
-	if (lirc_readconfig(lircrc, &config, NULL) != 0) {
-		printf("failed lirc_readconfig\n");
-		exit(EXIT_FAILURE);
+/*
+ * start and stop the asynchronous log
+ */
+void logstart(int fd) {
+	cookie_io_functions_t functions = {NULL, logappend, NULL, NULL};
+	FILE *f;
+
+	f = fopencookie(NULL, "w", functions);
+	if (f == NULL) {
+		perror("fopencookie");
+		return;
+	}
+	logwake = eventfd(0, EFD_CLOEXEC);
+	if (logwake == -1) {
+		perror("eventfd");
+		fclose(f);
+		return;
+	}
+	logfd = fd;
+	if (pthread_create(&logthread, NULL, logwriter, NULL) != 0) {
+		logprintf("cannot start the log writer thread\n");
+		fclose(f);
+		close(logwake);
+		logfd = -1;
+		return;
 	}
+	logflush();
+	logstream = f;
+}
+void logstop() {
+	if (logfd == -1)
+		return;
+	logflush();
+	atomic_store(&logstopping, True);
+	logsignal();
+	pthread_join(logthread, NULL);
+	fclose(logstream);
+	logstream = stdout;
+	close(logwake);
+	logfd = -1;
+}
 
-	while (lirc_nextcode(&code) == 0) {
-		if (code == NULL)
-			continue;
+/*
+ * the queue of the commands not coming from X events
+ */
+#define MAXQUEUE 32
+struct {
+	int command;
+	struct timespec received;
+} commandqueue[MAXQUEUE];
+int queuehead = 0, queuelen = 0;
+void commandpush(int command, struct timespec *received) {
+	int i;
+	if (queuelen >= MAXQUEUE) {
+		logprintf("WARNING: command queue full, dropping command %d\n",
+			command);
+		return;
+	}
+	i = (queuehead + queuelen) % MAXQUEUE;
+	commandqueue[i].command = command;
+	commandqueue[i].received = *received;
+	queuelen++;
+}
+int commandpop(struct timespec *received) {
+	int command;
+	if (queuelen == 0)
+		return NOCOMMAND;
+	command = commandqueue[queuehead].command;
+	*received = commandqueue[queuehead].received;
+	MODULEINCREASE(queuehead, MAXQUEUE, 1);
+	queuelen--;
+	return command;
+}
 
-		while (lirc_code2char(config, code, &c) == 0 && c != NULL) {
-			printf("lirc: %s\n", c);
+/*
+ * remove the forward and backward commands at the head of the queue, like
+ * NEXTPANEL and PREVPANEL, return the resulting relative jump
+ */
+int commandmerge(int forward, int backward) {
+	int rel, command;
+	for (rel = 0; queuelen > 0; queuelen--) {
+		command = commandqueue[queuehead].command;
+		if (command != forward && command != backward)
+			break;
+		logprintf("MERGED %s\n", commandtostring(command));
+		rel += command == backward ? -1 : 1;
+		MODULEINCREASE(queuehead, MAXQUEUE, 1);
+	}
+	return rel;
+}
+
+/*
+ * microseconds between two times, and elapsed since a given time
+ */
+long interval(struct timespec *from, struct timespec *to) {
+	return (to->tv_sec - from->tv_sec) * 1000000 +
+		(to->tv_nsec - from->tv_nsec) / 1000;
+}
+long elapsed(struct timespec *since) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return interval(since, &now);
+}
+
+/*
+ * acceleration of UPWINDOW and DOWNWINDOW: a command received within
+ * REPEATGAP of the same one is part of a hold, as from an autorepeating key
+ * or a remote button kept pressed; the step doubles every REPEATDOUBLE of
+ * holding, up to REPEATMAX
+ */
+#define REPEATGAP 400000	/* us */
+#define REPEATDOUBLE 1000000	/* us */
+#define REPEATMAX 16
+int repeatcommand = NOCOMMAND;
+struct timespec repeatstart, repeatlast;
+int repeatstep(int command, struct timespec *received) {
+	long held;
+
+	if (command != repeatcommand ||
+	    interval(&repeatlast, received) > REPEATGAP) {
+		repeatcommand = command;
+		repeatstart = *received;
+	}
+	repeatlast = *received;
+
+	held = interval(&repeatstart, received) / REPEATDOUBLE;
+	return held >= 4 ? REPEATMAX : 1 << held;
+}
 
-			message.type = ClientMessage;
-			message.xclient.window = root;
-			message.xclient.message_type = irwm;
-			message.xclient.format = 32;
+/*
+ * time of the last lirc code decoded, to measure the latency of the commands;
+ * cleared after each command from the queue, whether it entered a panel or not
+ */
+struct timespec lircstamp = {0, 0};
+void lircclear() {
+	lircstamp.tv_sec = 0;
+	lircstamp.tv_nsec = 0;
+}
+void lirclatency(char *where) {
+	if (lircstamp.tv_sec == 0 && lircstamp.tv_nsec == 0)
+		return;
+	logprintf("LATENCY lirc to %s: %ld us\n", where, elapsed(&lircstamp));
+	lircclear();
+}
 
-			message.xclient.data.l[0] = stringtocommand(c);
-			message.xclient.data.l[1] = 0;
-			message.xclient.data.l[2] = 0;
-			message.xclient.data.l[3] = 0;
-			message.xclient.data.l[4] = 0;
+/*
+ * latency histograms, one for each command and one for each event type
+ *
+ * bucket n counts the latencies between 2^(n-1) and 2^n microseconds; the
+ * latency of a command is from the receipt of the keystroke, message or lirc
+ * code to the end of its execution, after flushing the requests; the latency
+ * of an event is the time to handle it
+ */
+#define HISTOBUCKETS 32
+struct histogram {
+	unsigned long count[HISTOBUCKETS];
+	unsigned long total;
+	long max;
+};
+struct histogram commandstats[NUMWINDOW(0) + 1];
+struct histogram eventstats[LASTEvent];
 
-			XSendEvent(dsp, root, False, KeyPressMask, &message);
-			XFlush(dsp);
+void histoadd(struct histogram *h, long us) {
+	int b;
+	for (b = 0; b < HISTOBUCKETS - 1 && us >= (1L << b); b++) {
+	}
+	h->count[b]++;
+	h->total++;
+	if (us > h->max)
+		h->max = us;
+}
+long histopercentile(struct histogram *h, int percent) {
+	unsigned long n;
+	int b;
+	n = 0;
+	for (b = 0; b < HISTOBUCKETS - 1; b++) {
+		n += h->count[b];
+		if (n * 100 >= h->total * percent)
+			break;
+	}
+	return 1L << b;
+}
+void histoprint(char *type, char *name, struct histogram *h) {
+	if (h->total == 0)
+		return;
+	logprintf("STATS %-7s %-20s ", type, name);
+	logprintf("n=%-6lu ", h->total);
+	logprintf("p50<=%ldus ", histopercentile(h, 50));
+	logprintf("p90<=%ldus ", histopercentile(h, 90));
+	logprintf("p99<=%ldus ", histopercentile(h, 99));
+	logprintf("max=%ldus\n", h->max);
+}
+/*
+ * requests and round trips per event type; the requests made by a command are
+ * accounted to the event that caused it, the ones from other input to
+ * LASTEvent
+ */
+struct {
+	unsigned long events;
+	unsigned long requests;
+	unsigned long roundtrips;
+	unsigned long maxrequests;
+} requeststats[LASTEvent + 1];
+
+void requestadd(int type, unsigned long requests, unsigned long roundtrips) {
+	if (type < 0 || type > LASTEvent)
+		return;
+	requeststats[type].events++;
+	requeststats[type].requests += requests;
+	requeststats[type].roundtrips += roundtrips;
+	if (requests > requeststats[type].maxrequests)
+		requeststats[type].maxrequests = requests;
+}
+void requestprint(char *name, int type) {
+	unsigned long n;
+	n = requeststats[type].events;
+	if (n == 0)
+		return;
+	logprintf("REQUESTS %-20s ", name);
+	logprintf("n=%-6lu ", n);
+	logprintf("requests=%lu (%.1f/event, max %lu) ",
+		requeststats[type].requests,
+		(double) requeststats[type].requests / n,
+		requeststats[type].maxrequests);
+	logprintf("roundtrips=%lu (%.1f/event)\n",
+		requeststats[type].roundtrips,
+		(double) requeststats[type].roundtrips / n);
+}
+
+void commandstat(int command, struct timespec *received) {
+	if (command < 0)
+		return;
+	if (command > NUMWINDOW(0))
+		command = NUMWINDOW(0);
+	histoadd(&commandstats[command], elapsed(received));
+}
+
+/*
+ * lirc input: the socket is read in the main loop, its codes are translated
+ * into commands and queued
+ */
+#ifndef LIRC
+struct lirc_config;
+int lircopen(char *lircrc, struct lirc_config **config) {
+	(void) lircrc;
+	(void) config;
+	logprintf("irwm compiled without lirc support\n");
+	return -1;
+}
+int lircinput(struct lirc_config *config) {
+	(void) config;
+	return -1;
+}
+void lircclose(struct lirc_config *config) {
+	(void) config;
+}
+#else
+int lircopen(char *lircrc, struct lirc_config **config) {
+	int fd;
+
+	logprintf("lirc started: ");
+	logprintf("config file: %s\n", lircrc ? lircrc : "default");
+
+	fd = lirc_init(IRWM, 1);
+	if (fd == -1) {
+		logprintf("failed lirc_init\n");
+		return -1;
+	}
+
+	if (lirc_readconfig(lircrc, config, NULL) != 0) {
+		logprintf("failed lirc_readconfig\n");
+		lirc_deinit();
+		return -1;
+	}
+
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	return fd;
+}
+int lircinput(struct lirc_config *config) {
+	char *code, *c;
+	int res, command;
+
+	while ((res = lirc_nextcode(&code)) == 0 && code != NULL) {
+		clock_gettime(CLOCK_MONOTONIC, &lircstamp);
+		while (lirc_code2char(config, code, &c) == 0 && c != NULL) {
+			logprintf("lirc: %s\n", c);
+			command = stringtocommand(c);
+			if (command == -1)
+				logprintf("WARNING: no such command: %s\n", c);
+			else
+				commandpush(command, &lircstamp);
 		}
 		free(code);
 	}
 
+	return res;
+}
+void lircclose(struct lirc_config *config) {
 	lirc_freeconfig(config);
 	lirc_deinit();
-	XCloseDisplay(dsp);
-
-	printf("lirc client ended\n");
-	return EXIT_SUCCESS;
+	logprintf("lirc ended\n");
 }
 #endif
 
 /*
- * signal handler for reaping zombies
+ * reap zombies; called when the signalfd reports a signal
+ *
+ * the signalfd merges multiple SIGCHLD in one, so all terminated children are
+ * collected at once
  */
-int lircclient;
 void reaper(int s) {
 	int pid, status;
-	printf("signal %d\n", s);
-	if (s == SIGCHLD) {
-		pid = wait(&status);
-		printf("reaped child %d: ", pid);
-		printf("%s, ", WIFEXITED(status) ? "ended" : "terminated");
-		printf("exit status %d", WEXITSTATUS(status));
-		if (pid == lircclient) {
-			printf(" (lirc client)");
-			lircclient = -1;
-		}
-		printf("\n");
+	logprintf("signal %d\n", s);
+	if (s != SIGCHLD)
+		return;
+	while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+		logprintf("reaped child %d: ", pid);
+		logprintf("%s, ", WIFEXITED(status) ? "ended" : "terminated");
+		logprintf("exit status %d\n", WEXITSTATUS(status));
 	}
 }
 
+/*
+ * add a file descriptor to the set the main loop waits on
+ */
+void epolladd(int epfd, int fd) {
+	struct epoll_event ev;
+	if (fd == -1)
+		return;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == -1)
+		perror("epoll_ctl");
+}
+
+/*
+ * arm a timer to expire once after some milliseconds; 0 disarms it
+ */
+void timerset(int fd, long ms) {
+	struct itimerspec its;
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = ms / 1000;
+	its.it_value.tv_nsec = (ms % 1000) * 1000000;
+	timerfd_settime(fd, 0, &its, NULL);
+}
+
+/*
+ * consume the expiration of a timer
+ */
+void timerclear(int fd) {
+	uint64_t expirations;
+	if (read(fd, &expirations, sizeof(expirations)) == -1)
+		perror("timer");
+}
+
 /*
  * fork an external program
  */
 int forkprogram(char *path, char *arg) {
 	int pid;
 	char **argv;
+	sigset_t none;
 
-	printf("forking program %s with argument %s\n", path, arg);
-	fflush(stdout);
+	logprintf("forking program %s with argument %s\n", path, arg);
+	logflush();
 
 	if (path == NULL)
 		return 0;
 
 	pid = fork();
 	if (pid != 0) {
-		printf("pid=%d\n", pid);
+		logprintf("pid=%d\n", pid);
 		return pid;
 	}
 
+	sigemptyset(&none);
+	sigprocmask(SIG_SETMASK, &none, NULL);
+
 	argv = malloc(sizeof(char *) * (arg == NULL ? 2 : 3));
 	argv[0] = path;
 	argv[1] = arg;
@@ -435,20 +944,167 @@ int forkprogram(char *path, char *arg) {
 		argv[2] = NULL;
 	execvp(path, argv);
 	perror(path);
-	printf("cannot execute %s\n", path);
+	logprintf("cannot execute %s\n", path);
 	exit(EXIT_FAILURE);
 }
 
+/*
+ * growable storage: *array has room for *max elements of the given size; it is
+ * doubled when n elements do not fit and halved when less than a quarter is
+ * used, so that memory stays proportional to the elements in use; the removed
+ * elements leave their slots to the next ones
+ */
+#define MINSLOTS 16
+Bool arrayfit(void **array, int *max, size_t size, int n) {
+	int m;
+	void *a;
+
+	m = *max < MINSLOTS ? MINSLOTS : *max;
+	while (m < n)
+		m *= 2;
+	while (m > MINSLOTS && n <= m / 4)
+		m /= 2;
+	if (m == *max)
+		return True;
+
+	a = realloc(*array, m * size);
+	if (a == NULL) {
+		logprintf("WARNING: cannot allocate %d slots\n", m);
+		return n <= *max;
+	}
+	*array = a;
+	*max = m;
+	return True;
+}
+
+/*
+ * hash of a window in a table of the given size, a power of two
+ */
+int windowhash(Window win, int size) {
+	return (int) ((win * 0x9E3779B97F4A7C15ULL) >> 32) & (size - 1);
+}
+
+/*
+ * hash index from windows to slots in an array
+ *
+ * open addressing with linear probing; an entry is free if its window is None;
+ * deletion moves back the following entries of the same cluster, so that no
+ * tombstone is needed; the size is a power of two; when there is no memory for
+ * a larger index, the old one is kept as long as it has a free entry left
+ */
+struct windowindex {
+	Window win;
+	int pn;
+	int panelorcontent;
+};
+int windowindexfind(struct windowindex *index, int size, Window win) {
+	int h;
+	for (h = windowhash(win, size);
+	     index[h].win != None;
+	     h = (h + 1) & (size - 1))
+		if (index[h].win == win)
+			return h;
+	return h;
+}
+void windowindexset(struct windowindex *index, int size,
+		Window win, int pn, int panelorcontent) {
+	int h;
+	if (win == None || index == NULL)
+		return;
+	h = windowindexfind(index, size, win);
+	index[h].win = win;
+	index[h].pn = pn;
+	index[h].panelorcontent = panelorcontent;
+}
+void windowindexdelete(struct windowindex *index, int size, Window win) {
+	int h, i, k;
+	if (win == None || index == NULL)
+		return;
+	h = windowindexfind(index, size, win);
+	if (index[h].win == None)
+		return;
+	index[h].win = None;
+	for (i = (h + 1) & (size - 1);
+	     index[i].win != None;
+	     i = (i + 1) & (size - 1)) {
+		k = windowhash(index[i].win, size);
+		if (((i - k) & (size - 1)) < ((i - h) & (size - 1)))
+			continue;
+		index[h] = index[i];
+		index[i].win = None;
+		h = i;
+	}
+}
+struct windowindex *windowindexnew(int size) {
+	struct windowindex *index;
+	index = calloc(size, sizeof(struct windowindex));
+	if (index == NULL)
+		logprintf("WARNING: cannot allocate an index of %d windows\n",
+			size);
+	return index;
+}
+int windowindexget(struct windowindex *index, int size, Window win) {
+	int h;
+	if (win == None || index == NULL)
+		return -1;
+	h = windowindexfind(index, size, win);
+	return index[h].win == None ? -1 : index[h].pn;
+}
+
+/*
+ * tombstones: the windows known to be destroyed
+ *
+ * a window index like the panel one, with no slot; the set is emptied when
+ * half full, since a tombstone is only useful until the events about its
+ * window are over; a tombstone is removed when a window with the same id is
+ * created again
+ */
+#define TOMBSTONES 256
+struct windowindex tombstone[TOMBSTONES];
+int numtombstones = 0;
+Bool tombstoned(Window win) {
+	return numtombstones > 0 &&
+		windowindexget(tombstone, TOMBSTONES, win) != -1;
+}
+void tombadd(Window win) {
+	if (win == None || tombstoned(win))
+		return;
+	if (numtombstones >= TOMBSTONES / 2) {
+		logprintf("TOMBSTONES cleared\n");
+		memset(tombstone, 0, sizeof(tombstone));
+		numtombstones = 0;
+	}
+	windowindexset(tombstone, TOMBSTONES, win, 0, 0);
+	numtombstones++;
+	logprintf("TOMBSTONE 0x%lx\n", win);
+}
+void tombremove(Window win) {
+	if (! tombstoned(win))
+		return;
+	windowindexdelete(tombstone, TOMBSTONES, win);
+	numtombstones--;
+}
+
 /*
  * override_redirect windows
+ *
+ * stored in override[] without holes, indexed by window; the normal and the
+ * ontop ones are in two lists in the order they entered them, the ontop ones
+ * stacked over the others
  */
-#define MAXOVERRIDE 1000
-struct {
+struct override {
 	Window win;
+	int x, y, width, height, border;	/* from the last event */
 	int nx, ny;
+	char *class;		/* NULL if not read yet */
 	Bool ontop;
-} override[MAXOVERRIDE];
+	int prev, next;		/* in the list of the normal or ontop ones */
+} *override = NULL;
 int numoverride = 0;
+int maxoverride = 0;
+struct windowindex *overrideindex = NULL;
+int overrideindexsize = 0;
+int overridefirst[2] = {-1, -1}, overridelast[2] = {-1, -1};
 Bool raiseoverride = False;
 #define UNMOVED (-10000)
 
@@ -456,78 +1112,213 @@ Bool raiseoverride = False;
  * print an override window
  */
 void overrideprint(char *type, int i) {
-	printf("OVERRIDE %d %-10.10s 0x%lx", i, type, override[i].win);
+	logprintf("OVERRIDE %d %-10.10s 0x%lx", i, type, override[i].win);
 	if (override[i].nx != UNMOVED || override[i].ny != UNMOVED)
-		printf("%d,%d", override[i].nx, override[i].ny);
-	printf("\n");
+		logprintf("%d,%d", override[i].nx, override[i].ny);
+	logprintf("\n");
 }
 
 /*
  * check whether a window is in the list of the override windows
  */
 int overrideexists(Window win) {
+	return windowindexget(overrideindex, overrideindexsize, win);
+}
+
+/*
+ * resize the override storage to n windows, rebuilding the index if needed
+ */
+Bool overridefit(int n) {
+	struct windowindex *index;
 	int i;
-	for (i = 0; i < numoverride; i++)
-		if (win == override[i].win)
-			return i;
-	return -1;
+
+	if (! arrayfit((void **) &override, &maxoverride,
+			sizeof(struct override), n))
+		return False;
+	if (overrideindexsize == maxoverride * 4)
+		return True;
+
+	index = windowindexnew(maxoverride * 4);
+	if (index == NULL)
+		return overrideindex != NULL && n < overrideindexsize;
+	free(overrideindex);
+	overrideindex = index;
+	overrideindexsize = maxoverride * 4;
+	for (i = 0; i < numoverride && i < n; i++)
+		windowindexset(overrideindex, overrideindexsize,
+			override[i].win, i, 0);
+	return True;
+}
+
+/*
+ * append an override window to its list, or unlink it from it
+ */
+void overridelink(int i) {
+	int *first, *last;
+	first = &overridefirst[override[i].ontop ? 1 : 0];
+	last = &overridelast[override[i].ontop ? 1 : 0];
+	override[i].prev = *last;
+	override[i].next = -1;
+	if (*last == -1)
+		*first = i;
+	else
+		override[*last].next = i;
+	*last = i;
+}
+void overrideunlink(int i) {
+	int *first, *last;
+	first = &overridefirst[override[i].ontop ? 1 : 0];
+	last = &overridelast[override[i].ontop ? 1 : 0];
+	if (override[i].prev == -1)
+		*first = override[i].next;
+	else
+		override[override[i].prev].next = override[i].next;
+	if (override[i].next == -1)
+		*last = override[i].prev;
+	else
+		override[override[i].next].prev = override[i].prev;
 }
 
 /*
  * add an override window
  */
-void overrideadd(Window win) {
-	if (numoverride >= MAXOVERRIDE) {
-		printf("WARNING: too many override_redirect windows\n");
-		return;
-	}
+void overrideadd(XCreateWindowEvent *e) {
+	Window win = e->window;
 	if (overrideexists(win) != -1)
 		return;
+	if (! overridefit(numoverride + 1)) {
+		logprintf("WARNING: too many override_redirect windows\n");
+		return;
+	}
 	override[numoverride].win = win;
+	override[numoverride].x = e->x;
+	override[numoverride].y = e->y;
+	override[numoverride].width = e->width;
+	override[numoverride].height = e->height;
+	override[numoverride].border = e->border_width;
 	override[numoverride].nx = UNMOVED;
 	override[numoverride].ny = UNMOVED;
+	override[numoverride].class = NULL;
 	override[numoverride].ontop = False;
+	overridelink(numoverride);
+	windowindexset(overrideindex, overrideindexsize, win, numoverride, 0);
 	overrideprint("ADD", numoverride);
 	numoverride++;
 }
 
 /*
- * remove an override window
+ * remove an override window; the last one takes its place
  */
 void overrideremove(Window win) {
-	int i;
-	for (i = 0; i < numoverride; i++)
-		if (override[i].win == win) {
-			overrideprint("REMOVE", i);
-			numoverride--;
-			override[i] = override[numoverride];
-			return;
-		}
+	int i, last;
+
+	i = overrideexists(win);
+	if (i == -1)
+		return;
+	overrideprint("REMOVE", i);
+	overrideunlink(i);
+	free(override[i].class);
+	windowindexdelete(overrideindex, overrideindexsize, win);
+
+	last = numoverride - 1;
+	if (i != last) {
+		override[i] = override[last];
+		if (override[i].prev == -1)
+			overridefirst[override[i].ontop ? 1 : 0] = i;
+		else
+			override[override[i].prev].next = i;
+		if (override[i].next == -1)
+			overridelast[override[i].ontop ? 1 : 0] = i;
+		else
+			override[override[i].next].prev = i;
+		windowindexset(overrideindex, overrideindexsize,
+			override[i].win, i, 0);
+	}
+	numoverride--;
+	overridefit(numoverride);
 }
 
 /*
- * raise all override windows
+ * change whether an override window stays on top of the others
  */
-void overrideraise(Display *dsp) {
-	int i;
-	if (! raiseoverride)
+void overrideontop(int i, Bool ontop) {
+	if (override[i].ontop == ontop)
 		return;
-	for (i = 0; i < numoverride; i++)
-		if (! override[i].ontop) {
-			overrideprint("RAISE", i);
-			XRaiseWindow(dsp, override[i].win);
-		}
-	for (i = 0; i < numoverride; i++)
-		if (override[i].ontop) {
-			overrideprint("RAISE", i);
-			XRaiseWindow(dsp, override[i].win);
-		}
+	overrideunlink(i);
+	override[i].ontop = ontop;
+	overridelink(i);
 }
 
 /*
- * fix placement of an override windows
+ * update the geometry of an override window
  */
-int randombetween(int d, int c, int rc) {
+void overridegeometry(XConfigureEvent *e) {
+	int i;
+	i = overrideexists(e->window);
+	if (i == -1)
+		return;
+	override[i].x = e->x;
+	override[i].y = e->y;
+	override[i].width = e->width;
+	override[i].height = e->height;
+	override[i].border = e->border_width;
+}
+
+/*
+ * class of an override window, the empty string if none
+ */
+char *overrideclass(Display *dsp, int i) {
+	XClassHint ch;
+	if (override[i].class != NULL)
+		return override[i].class;
+	if (! ROUNDTRIP(XGetClassHint(dsp, override[i].win, &ch)))
+		override[i].class = strdup("");
+	else {
+		override[i].class = strdup(ch.res_class);
+		XFree(ch.res_name);
+		XFree(ch.res_class);
+	}
+	return override[i].class;
+}
+
+/*
+ * placements of override windows by class and size, the oldest replaced when
+ * the table is full
+ */
+#define PLACEMENTS 64
+struct placement {
+	char *class;
+	int width, height;
+	int x, y;
+} placement[PLACEMENTS];
+int numplacement = 0, nextplacement = 0;
+struct placement *placementfind(char *class, int width, int height) {
+	int i;
+	for (i = 0; i < numplacement; i++)
+		if (placement[i].width == width &&
+		    placement[i].height == height &&
+		    ! strcmp(placement[i].class, class))
+			return &placement[i];
+	return NULL;
+}
+struct placement *placementadd(char *class, int width, int height) {
+	struct placement *p;
+	p = &placement[nextplacement];
+	if (nextplacement < numplacement)
+		free(p->class);
+	else
+		numplacement++;
+	nextplacement = (nextplacement + 1) % PLACEMENTS;
+	p->class = strdup(class);
+	p->width = width;
+	p->height = height;
+	return p;
+}
+
+/*
+ * fix placement of an override windows
+ */
+int randombetween(int d, int c, int rc) {
 	if (c >= rc && c <= rc + d)
 		return c;
 	if (rand() % 3 == 0)
@@ -536,49 +1327,93 @@ int randombetween(int d, int c, int rc) {
 		return rc + d;
 	return rc + (rand() % (d + (d < 0 ? -1 : 1)) + (d < 0 ? d : 0));
 }
+int placementnext(int d, int c, int rc, int p, int size) {
+	if (c >= rc && c <= rc + d)
+		return c;
+	if (d >= 0)
+		return p;
+	if (p <= rc + d)
+		return rc;
+	return p - size < rc + d ? rc + d : p - size;
+}
 void overrideplace(Display *dsp, Window win, XWindowAttributes *rwa) {
-	XWindowAttributes wa;
+	struct override *o;
+	struct placement *p;
+	char *class;
 	int i;
-	int d;
-	for (i = 0; i < numoverride; i++) {
-		if (override[i].win == win) {
-			XGetWindowAttributes(dsp, win, &wa);
-			if (override[i].nx == wa.x && override[i].ny == wa.y)
-				return;
-
-			d = rwa->width - wa.width - 2 * wa.border_width;
-			override[i].nx = randombetween(d, wa.x, rwa->x);
-			d = rwa->height - wa.height - 2 * wa.border_width;
-			override[i].ny = randombetween(d, wa.y, rwa->y);
-
-			if (override[i].nx == wa.x && override[i].ny == wa.y)
-				return;
-			XMoveWindow(dsp, win, override[i].nx, override[i].ny);
-			overrideprint("MOVE", i);
-			printf("\tmoved to %d,%d\n",
-				override[i].nx, override[i].ny);
-			return;
-		}
+	int dx, dy;
+	if (tombstoned(win))
+		return;
+	i = overrideexists(win);
+	if (i == -1)
+		return;
+	o = &override[i];
+
+	if (o->nx == o->x && o->ny == o->y)
+		return;
+	dx = rwa->width - o->width - 2 * o->border;
+	dy = rwa->height - o->height - 2 * o->border;
+	if (o->x >= rwa->x && o->x <= rwa->x + dx &&
+	    o->y >= rwa->y && o->y <= rwa->y + dy)
+		return;
+
+	class = overrideclass(dsp, i);
+	p = placementfind(class, o->width, o->height);
+	if (p == NULL) {
+		o->nx = randombetween(dx, o->x, rwa->x);
+		o->ny = randombetween(dy, o->y, rwa->y);
+		p = placementadd(class, o->width, o->height);
+	}
+	else {
+		o->nx = placementnext(dx, o->x, rwa->x, p->x, rwa->width);
+		o->ny = placementnext(dy, o->y, rwa->y, p->y, rwa->height);
+		logprintf("PLACEMENT \"%s\" %dx%d from %d,%d\n", class,
+			o->width, o->height, p->x, p->y);
 	}
+	p->x = o->nx;
+	p->y = o->ny;
+
+	if (o->nx == o->x && o->ny == o->y)
+		return;
+	XMoveWindow(dsp, win, o->nx, o->ny);
+	overrideprint("MOVE", i);
+	logprintf("\tmoved to %d,%d\n", o->nx, o->ny);
 }
 
 /*
  * the panels and their contents
+ *
+ * a panel keeps its slot in panel[] from creation to destruction, and the slot
+ * number identifies it; the order of the panels is a doubly linked list from
+ * firstpanel to lastpanel through the prev and next fields; the free slots
+ * below toppanels are linked in the same way
  */
-#define MAXPANELS 1000
 struct panel {
-	Window panel;		/* container for a window */
+	Window panel;		/* container for a window; None if free */
 	Window content;		/* a window created by some program */
-	char *name;		/* name of the window */
+	char *name;		/* name of the window, in utf-8 */
+	char *label;		/* name as shown in the panel list, or NULL */
 	Window leader;		/* group leader, or None */
 	Bool withdrawn;		/* content is withdrawn by program */
-} panel[MAXPANELS];
+	int deletewindow;	/* supports WM_DELETE_WINDOW, -1 if unknown */
+	Bool warm;		/* kept mapped under the active panel */
+	int prev, next;		/* order of panels, or list of free slots */
+	int groupprev, groupnext;	/* panels with the same leader */
+	int mruprev, mrunext;	/* most recently used order */
+} *panel = NULL;
 int numpanels = 0;
+int toppanels = 0;		/* the slots from this on are all free */
+int maxpanels = 0;
+int firstpanel = -1, lastpanel = -1;
+int firstfree = -1, lastfree = -1;
 int numactive = 0;
 int activepanel = -1;
-int previouspanel = -1;
+int firstmru = -1, lastmru = -1;
+Bool mrufrozen = False;		/* entering panels does not change the order */
+Bool mruorder = False;		/* panel list in most recently used order */
 Window activecontent = None;
 Bool unmaponleave = False;	/* unmap window when switching to another */
+int warmpanels = 0;		/* panels kept mapped under the active one */
 Window activewindow = None;	/* may not be the content of a panel */
 Window panelroof;		/* all panels under the same roof */
 
@@ -586,48 +1421,422 @@ Window panelroof;		/* all panels under the same roof */
  * print data of a panel
  */
 void panelprint(char *type, int pn) {
-	printf("PANEL %d %-10.10s ", pn, type);
-	printf("%s ", pn == activepanel ? "*" : " ");
-	printf("%s ", activecontent == panel[pn].content ? "=" : " ");
-	printf("panel=0x%lx ", panel[pn].panel);
-	printf("content=0x%lx ", panel[pn].content);
-	printf("title=%s", panel[pn].name);
-	printf("\n");
+	logprintf("PANEL %d %-10.10s ", pn, type);
+	logprintf("%s ", pn == activepanel ? "*" : " ");
+	logprintf("%s ", activecontent == panel[pn].content ? "=" : " ");
+	logprintf("panel=0x%lx ", panel[pn].panel);
+	logprintf("content=0x%lx ", panel[pn].content);
+	logprintf("title=%s", panel[pn].name);
+	logprintf("\n");
 }
 
 /*
- * index of a panel and/or content (not found: -1)
+ * hash indexes from windows to panel numbers: from the panel and content
+ * windows to their panels, and from the leaders to the first panel of their
+ * group; their size is four times the number of panel slots, and they are
+ * rebuilt when the panel storage is resized
  */
 #define PANEL	(1<<0)
 #define CONTENT (1<<1)
-int panelfind(Window p, int panelorcontent) {
+#define GROUP	(1<<2)
+struct windowindex *panelindex = NULL, *groupindex = NULL;
+int panelindexsize = 0;
+int panelindexfind(struct windowindex *index, Window win) {
+	return windowindexfind(index, panelindexsize, win);
+}
+void panelindexset(struct windowindex *index,
+		Window win, int pn, int panelorcontent) {
+	windowindexset(index, panelindexsize, win, pn, panelorcontent);
+}
+void panelindexdelete(struct windowindex *index, Window win) {
+	windowindexdelete(index, panelindexsize, win);
+}
+void panelindexupdate(int pn) {
+	panelindexset(panelindex, panel[pn].panel, pn, PANEL);
+	panelindexset(panelindex, panel[pn].content, pn, CONTENT);
+	if (panel[pn].leader != None && panel[pn].groupprev == -1)
+		panelindexset(groupindex, panel[pn].leader, pn, GROUP);
+}
+
+/*
+ * the groups: the panels having the same leader are linked through groupnext,
+ * from the one in the group index; closing or withdrawing a window only looks
+ * at the panels it leads
+ */
+int groupfirst(Window leader) {
+	int h;
+	if (leader == None || groupindex == NULL)
+		return -1;
+	h = panelindexfind(groupindex, leader);
+	return groupindex[h].win == None ? -1 : groupindex[h].pn;
+}
+void groupadd(int pn) {
+	int first;
+	panel[pn].groupprev = -1;
+	panel[pn].groupnext = -1;
+	if (panel[pn].leader == None)
+		return;
+	first = groupfirst(panel[pn].leader);
+	panel[pn].groupnext = first;
+	if (first != -1)
+		panel[first].groupprev = pn;
+	panelindexset(groupindex, panel[pn].leader, pn, GROUP);
+}
+void groupremove(int pn) {
+	int prev, next;
+	if (panel[pn].leader == None)
+		return;
+	prev = panel[pn].groupprev;
+	next = panel[pn].groupnext;
+	if (prev != -1)
+		panel[prev].groupnext = next;
+	else if (next != -1)
+		panelindexset(groupindex, panel[pn].leader, next, GROUP);
+	else
+		panelindexdelete(groupindex, panel[pn].leader);
+	if (next != -1)
+		panel[next].groupprev = prev;
+}
+
+/*
+ * resize the panel storage to n panels, rebuilding the index if needed
+ */
+Bool panelfit(int n) {
+	struct windowindex *index, *group;
 	int i;
 
-	for (i = 0; i < numpanels; i++) {
-		if (panelorcontent & PANEL && p == panel[i].panel)
-			return i;
-		if (panelorcontent & CONTENT && p == panel[i].content)
-			return i;
+	if (! arrayfit((void **) &panel, &maxpanels, sizeof(struct panel), n))
+		return False;
+	if (panelindexsize == maxpanels * 4)
+		return True;
+
+	index = windowindexnew(maxpanels * 4);
+	group = windowindexnew(maxpanels * 4);
+	if (index == NULL || group == NULL) {
+		free(index);
+		free(group);
+		return panelindex != NULL && n * 2 < panelindexsize;
+	}
+	free(panelindex);
+	free(groupindex);
+	panelindex = index;
+	groupindex = group;
+	panelindexsize = maxpanels * 4;
+	for (i = 0; i < toppanels && i < n; i++)
+		if (panel[i].panel != None)
+			panelindexupdate(i);
+	return True;
+}
+
+/*
+ * append a panel to a list, or unlink it from it
+ */
+void panelappend(int pn, int *first, int *last) {
+	panel[pn].prev = *last;
+	panel[pn].next = -1;
+	if (*last == -1)
+		*first = pn;
+	else
+		panel[*last].next = pn;
+	*last = pn;
+}
+void panelunlink(int pn, int *first, int *last) {
+	if (panel[pn].prev == -1)
+		*first = panel[pn].next;
+	else
+		panel[panel[pn].prev].next = panel[pn].next;
+	if (panel[pn].next == -1)
+		*last = panel[pn].prev;
+	else
+		panel[panel[pn].next].prev = panel[pn].prev;
+	panel[pn].prev = -1;
+	panel[pn].next = -1;
+}
+
+/*
+ * allocate the slot for a new panel, or free the slot of a destroyed one; the
+ * free list is kept in increasing order and the lowest slot is reused, so that
+ * the highest panels are the last to be taken and toppanels can go down
+ */
+int panelslot() {
+	int pn;
+	if (firstfree != -1) {
+		pn = firstfree;
+		panelunlink(pn, &firstfree, &lastfree);
+		return pn;
+	}
+	if (! panelfit(toppanels + 1))
+		return -1;
+	return toppanels++;
+}
+void panelrelease(int pn) {
+	int i;
+	panel[pn].panel = None;
+	panel[pn].content = None;
+	for (i = lastfree; i != -1 && i > pn; i = panel[i].prev)
+		;
+	panel[pn].prev = i;
+	panel[pn].next = i == -1 ? firstfree : panel[i].next;
+	if (panel[pn].prev == -1)
+		firstfree = pn;
+	else
+		panel[panel[pn].prev].next = pn;
+	if (panel[pn].next == -1)
+		lastfree = pn;
+	else
+		panel[panel[pn].next].prev = pn;
+	while (toppanels > 0 && panel[toppanels - 1].panel == None) {
+		panelunlink(toppanels - 1, &firstfree, &lastfree);
+		toppanels--;
 	}
+	panelfit(toppanels);
+}
+
+/*
+ * the panel after (rel > 0) or before (rel < 0) another, cyclically
+ */
+int panelnext(int pn, int rel) {
+	if (rel > 0)
+		return panel[pn].next != -1 ? panel[pn].next : firstpanel;
+	else
+		return panel[pn].prev != -1 ? panel[pn].prev : lastpanel;
+}
+
+/*
+ * the most recently used order: a list of the non-withdrawn panels from
+ * firstmru to lastmru through mrunext, updated in constant time; entering a
+ * panel moves it to the front, unless the order is frozen while the user is
+ * moving in the panel list
+ */
+void mruappend(int pn) {
+	panel[pn].mruprev = lastmru;
+	panel[pn].mrunext = -1;
+	if (lastmru == -1)
+		firstmru = pn;
+	else
+		panel[lastmru].mrunext = pn;
+	lastmru = pn;
+}
+void mruunlink(int pn) {
+	if (panel[pn].mruprev == -1)
+		firstmru = panel[pn].mrunext;
+	else
+		panel[panel[pn].mruprev].mrunext = panel[pn].mrunext;
+	if (panel[pn].mrunext == -1)
+		lastmru = panel[pn].mruprev;
+	else
+		panel[panel[pn].mrunext].mruprev = panel[pn].mruprev;
+}
+void mrupush(int pn) {
+	if (mrufrozen || pn == -1 || pn == firstmru)
+		return;
+	mruunlink(pn);
+	panel[pn].mruprev = -1;
+	panel[pn].mrunext = firstmru;
+	if (firstmru == -1)
+		lastmru = pn;
+	else
+		panel[firstmru].mruprev = pn;
+	firstmru = pn;
+}
 
+/*
+ * the non-withdrawn panels in the order of the panel list, either the order
+ * of the panels or the most recently used
+ */
+int panelfirst() {
+	int pn;
+	if (mruorder)
+		return firstmru;
+	for (pn = firstpanel; pn != -1 && panel[pn].withdrawn; )
+		pn = panel[pn].next;
+	return pn;
+}
+int panelfollowing(int pn) {
+	if (mruorder)
+		return panel[pn].mrunext;
+	do {
+		pn = panel[pn].next;
+	} while (pn != -1 && panel[pn].withdrawn);
+	return pn;
+}
+
+/*
+ * the n-th panel in the panel list, starting from 0 (none: -1)
+ */
+int panelnth(int n) {
+	int pn;
+	for (pn = panelfirst(); pn != -1; pn = panelfollowing(pn))
+		if (n-- == 0)
+			return pn;
 	return -1;
 }
 
 /*
- * retrieve and store the name of the window in a panel
+ * position of a panel in the panel list
  */
-void panelname(Display *dsp, int pn) {
+int panelposition(int pn) {
+	int i, n;
+	n = 0;
+	for (i = panelfirst(); i != -1 && i != pn; i = panelfollowing(i))
+		n++;
+	return n;
+}
+
+/*
+ * index of a panel and/or content (not found: -1)
+ */
+int panelfind(Window p, int panelorcontent) {
+	int h;
+
+	if (p == None || panelindex == NULL)
+		return -1;
+	h = panelindexfind(panelindex, p);
+	if (panelindex[h].win == None)
+		return -1;
+	if (! (panelindex[h].panelorcontent & panelorcontent))
+		return -1;
+	return panelindex[h].pn;
+}
+
+/*
+ * convert a latin-1 string to utf-8
+ */
+char *latin1toutf8(char *s) {
+	unsigned char *c;
+	char *u, *d;
+
+	u = malloc(strlen(s) * 2 + 1);
+	for (c = (unsigned char *) s, d = u; *c != '\0'; c++)
+		if (*c < 0x80)
+			*d++ = *c;
+		else {
+			*d++ = 0xC0 | (*c >> 6);
+			*d++ = 0x80 | (*c & 0x3F);
+		}
+	*d = '\0';
+	return u;
+}
+
+/*
+ * convert a utf-8 string to latin-1, with '?' for the other characters
+ */
+char *utf8tolatin1(char *s) {
+	unsigned char *c;
+	char *l, *d;
+	int n, code;
+
+	l = malloc(strlen(s) + 1);
+	for (c = (unsigned char *) s, d = l; *c != '\0'; ) {
+		if (*c < 0x80) {
+			*d++ = *c++;
+			continue;
+		}
+		n = *c >= 0xF0 ? 3 : *c >= 0xE0 ? 2 : *c >= 0xC0 ? 1 : 0;
+		code = n == 0 ? 0x100 : *c & (0x3F >> n);
+		for (c++; n > 0 && (*c & 0xC0) == 0x80; n--, c++)
+			code = (code << 6) | (*c & 0x3F);
+		*d++ = n == 0 && code < 0x100 ? code : '?';
+	}
+	*d = '\0';
+	return l;
+}
+
+/*
+ * convert a text property to utf-8, or NULL
+ */
+char *textname(Display *dsp, XTextProperty *t) {
+	char **list, *name;
+	int n;
+
+	name = NULL;
+	list = NULL;
+	if (t->value == NULL || t->format != 8)
+		logprintf("invalid text property\n");
+	else if (t->encoding == utf8_string)
+		name = strndup((char *) t->value, t->nitems);
+	else if (t->encoding == XA_STRING) {
+		if (XTextPropertyToStringList(t, &list, &n) && n > 0)
+			name = latin1toutf8(list[0]);
+	}
+	else if (Xutf8TextPropertyToTextList(dsp, t, &list, &n) >= Success) {
+		if (n > 0)
+			name = strdup(list[0]);
+	}
+	if (list != NULL)
+		XFreeStringList(list);
+	return name;
+}
+
+/*
+ * the name of a window in utf-8, or NULL
+ *
+ * _NET_WM_NAME is preferred since it is utf-8 already; otherwise, WM_NAME is
+ * converted from its encoding: STRING is latin-1, COMPOUND_TEXT depends on
+ * the locale
+ */
+char *windowname(Display *dsp, Window win) {
+	Atom type;
+	int format;
+	unsigned long len, after;
+	unsigned char *data;
 	XTextProperty t;
+	char *name;
+
+	if (ROUNDTRIP(XGetWindowProperty(dsp, win, net_wm_name, 0, 1024,
+			False, utf8_string, &type, &format, &len, &after,
+			&data)) == Success && data != NULL) {
+		name = type == utf8_string && format == 8 ?
+			strdup((char *) data) : NULL;
+		XFree(data);
+		if (name != NULL)
+			return name;
+	}
+
+	if (! ROUNDTRIP(XGetWMName(dsp, win, &t)))
+		return NULL;
+	name = textname(dsp, &t);
+	XFree(t.value);
+	return name;
+}
+
+/*
+ * the properties of a new window that irwm needs, one round trip each
+ */
+struct windowinfo {
+	Bool transient;		/* has WM_TRANSIENT_FOR */
+	Window transientfor;
+	char *name;		/* utf-8 name, or NULL */
+};
+void windowinfo(Display *dsp, Window win, struct windowinfo *info) {
+	memset(info, 0, sizeof(struct windowinfo));
+	info->transient = ROUNDTRIP(XGetTransientForHint(dsp, win,
+		&info->transientfor));
+	info->name = windowname(dsp, win);
+}
+
+/*
+ * print the properties of a new window
+ */
+void windowinfoprint(struct windowinfo *info) {
+	logprintf("\tname=%s\n", info->name ? info->name : "(none)");
+}
 
-	if (! XGetWMName(dsp, panel[pn].content, &t)) {
-		printf("no name for window 0x%lx\n", panel[pn].content);
+/*
+ * retrieve and store the name of the window in a panel; called when the panel
+ * is created and when the name changes, the panel list only uses the stored
+ * name and its label; if name is not NULL, it is the already retrieved name
+ */
+void panelname(Display *dsp, int pn, char *name) {
+	free(panel[pn].name);
+	free(panel[pn].label);
+	panel[pn].label = NULL;
+	panel[pn].name = name != NULL ? name :
+		windowname(dsp, panel[pn].content);
+	if (panel[pn].name == NULL) {
+		logprintf("no name for window 0x%lx\n", panel[pn].content);
 		panel[pn].name = strdup("NoName");
-		return;
 	}
-	/* FIXME: this implicitely assumes that the title is a string; it
-	 * should instead check t.encoding and use XTextPropertyToStringList if
-	 * string; see XTextProperty(3) and Xutil.h */
-	panel[pn].name = strdup((char *) t.value);
 }
 
 /*
@@ -640,42 +1849,363 @@ void paneltitle(Display *dsp, int pn) {
 }
 
 /*
- * create a new panel for a window
+ * create a new panel for a window; name is its already retrieved name, or NULL
  */
 int paneladd(Display *dsp, Window root, Window win, XWindowAttributes *wa,
-		Window leader) {
-	int e;
+		Window leader, char *name) {
+	int e, pn;
 	Window p;
 
-	if (numpanels >= MAXPANELS) {
-		printf("IRWM ERROR: too many open panels, ");
-		printf("not creating a new one for window 0x%lx\n", win);
-		return -1;
-	}
-
 	e = panelfind(win, PANEL | CONTENT);
 	if (e != -1) {
-		printf("IRWM NOTE: window 0x%lx already exists\n", win);
+		logprintf("IRWM NOTE: window 0x%lx already exists\n", win);
+		free(name);
 		return e;
 	}
 
+	pn = panelslot();
+	if (pn == -1) {
+		logprintf("IRWM ERROR: too many open panels, ");
+		logprintf("not creating a new one for window 0x%lx\n", win);
+		free(name);
+		return -1;
+	}
+
 	p = XCreateSimpleWindow(dsp, root, wa->x, wa->y, wa->width, wa->height,
 			0, 0, WhitePixel(dsp, DefaultScreen(dsp)));
 	XSelectInput(dsp, p, SubstructureNotifyMask);
+	XSelectInput(dsp, win, PropertyChangeMask);
 	XReparentWindow(dsp, win, p, 0, 0);
 
-	panel[numpanels].panel = p;
-	panel[numpanels].content = win;
-	panel[numpanels].name = NULL;
-	panelname(dsp, numpanels);
-	panel[numpanels].leader = leader;
-	panel[numpanels].withdrawn = False;
-	paneltitle(dsp, numpanels);
+	panel[pn].panel = p;
+	panel[pn].content = win;
+	panel[pn].name = NULL;
+	panel[pn].label = NULL;
+	panelname(dsp, pn, name);
+	panel[pn].leader = leader;
+	groupadd(pn);
+	panel[pn].withdrawn = False;
+	panel[pn].deletewindow = -1;
+	panel[pn].warm = False;
+	panelappend(pn, &firstpanel, &lastpanel);
+	mruappend(pn);
+	paneltitle(dsp, pn);
+	panelindexupdate(pn);
+
+	panelprint("CREATE", pn);
+
+	numpanels++;
+	numactive++;
+	return pn;
+}
 
-	panelprint("CREATE", numpanels);
+/*
+ * stacking order of the children of root, as reported by the server
+ *
+ * a mirror of the server: it is updated by the CreateNotify, ConfigureNotify,
+ * CirculateNotify, ReparentNotify and DestroyNotify events when they are read,
+ * before coalescing, and by the restacks irwm requests when it requests them;
+ * stored in stack[] without holes, indexed by window and linked from bottom to
+ * top
+ */
+struct stack {
+	Window win;
+	int below, above;
+	int rank;		/* from the top, while restacking */
+	unsigned long serial;	/* of the last restack requested by irwm */
+} *stack = NULL;
+int numstack = 0;
+int maxstack = 0;
+struct windowindex *stackindex = NULL;
+int stackindexsize = 0;
+int stackbottom = -1, stacktop = -1;
 
-	numactive++;
-	return numpanels++;
+/*
+ * resize the stack storage to n windows, rebuilding the index if needed
+ */
+Bool stackfit(int n) {
+	struct windowindex *index;
+	int i;
+
+	if (! arrayfit((void **) &stack, &maxstack, sizeof(struct stack), n))
+		return False;
+	if (stackindexsize == maxstack * 4)
+		return True;
+
+	index = windowindexnew(maxstack * 4);
+	if (index == NULL)
+		return stackindex != NULL && n < stackindexsize;
+	free(stackindex);
+	stackindex = index;
+	stackindexsize = maxstack * 4;
+	for (i = 0; i < numstack && i < n; i++)
+		windowindexset(stackindex, stackindexsize, stack[i].win, i, 0);
+	return True;
+}
+
+/*
+ * link a window just above another, or at the bottom if that is -1; unlink it
+ */
+void stacklink(int i, int below) {
+	stack[i].below = below;
+	stack[i].above = below == -1 ? stackbottom : stack[below].above;
+	if (stack[i].below == -1)
+		stackbottom = i;
+	else
+		stack[stack[i].below].above = i;
+	if (stack[i].above == -1)
+		stacktop = i;
+	else
+		stack[stack[i].above].below = i;
+}
+void stackunlink(int i) {
+	if (stack[i].below == -1)
+		stackbottom = stack[i].above;
+	else
+		stack[stack[i].below].above = stack[i].above;
+	if (stack[i].above == -1)
+		stacktop = stack[i].below;
+	else
+		stack[stack[i].above].below = stack[i].below;
+}
+
+/*
+ * add a window on top of the others, if not already known
+ */
+void stackadd(Window win) {
+	if (windowindexget(stackindex, stackindexsize, win) != -1)
+		return;
+	if (! stackfit(numstack + 1)) {
+		logprintf("WARNING: too many top-level windows\n");
+		return;
+	}
+	stack[numstack].win = win;
+	stack[numstack].serial = 0;
+	stacklink(numstack, stacktop);
+	windowindexset(stackindex, stackindexsize, win, numstack, 0);
+	numstack++;
+}
+
+/*
+ * remove a window; the last one takes its place
+ */
+void stackremove(Window win) {
+	int i, last;
+
+	i = windowindexget(stackindex, stackindexsize, win);
+	if (i == -1)
+		return;
+	stackunlink(i);
+	windowindexdelete(stackindex, stackindexsize, win);
+
+	last = numstack - 1;
+	if (i != last) {
+		stack[i] = stack[last];
+		if (stack[i].below == -1)
+			stackbottom = i;
+		else
+			stack[stack[i].below].above = i;
+		if (stack[i].above == -1)
+			stacktop = i;
+		else
+			stack[stack[i].above].below = i;
+		windowindexset(stackindex, stackindexsize, stack[i].win, i, 0);
+	}
+	numstack--;
+	stackfit(numstack);
+}
+
+/*
+ * move a window just above a sibling, or to the bottom if this is None; an
+ * unknown sibling leaves the window where it is
+ */
+void stackmove(Window win, Window sibling) {
+	int i, s;
+
+	stackadd(win);
+	i = windowindexget(stackindex, stackindexsize, win);
+	if (i == -1)
+		return;
+	s = windowindexget(stackindex, stackindexsize, sibling);
+	if (sibling != None && s == -1)
+		return;
+	if (s == i || stack[i].below == s)
+		return;
+	stackunlink(i);
+	stacklink(i, s);
+}
+
+/*
+ * update the stacking order from an event
+ */
+void stacknotify(XEvent *e, Window root) {
+	int i;
+
+	if (e->xany.send_event)
+		return;
+	switch (e->type) {
+	case CreateNotify:
+		if (e->xcreatewindow.parent == root)
+			stackadd(e->xcreatewindow.window);
+		break;
+	case DestroyNotify:
+		if (e->xdestroywindow.event == root)
+			stackremove(e->xdestroywindow.window);
+		break;
+	case ReparentNotify:
+		if (e->xreparent.event != root)
+			break;
+		stackremove(e->xreparent.window);
+		if (e->xreparent.parent == root)
+			stackadd(e->xreparent.window);
+		break;
+	case ConfigureNotify:
+		if (e->xconfigure.event != root)
+			break;
+		i = windowindexget(stackindex, stackindexsize,
+			e->xconfigure.window);
+		if (i != -1 && e->xany.serial <= stack[i].serial)
+			break;		/* already in the mirror */
+		stackmove(e->xconfigure.window, e->xconfigure.above);
+		break;
+	case CirculateNotify:
+		if (e->xcirculate.event != root)
+			break;
+		if (e->xcirculate.place == PlaceOnBottom)
+			stackmove(e->xcirculate.window, None);
+		else {
+			stackremove(e->xcirculate.window);
+			stackadd(e->xcirculate.window);
+		}
+		break;
+	}
+}
+
+/*
+ * restack a window above or below a sibling, or on top if this is None, and
+ * update the mirror at once; the events about the window up to the one this
+ * request causes are then ignored, since the mirror already includes them
+ */
+void stackrequest(Display *dsp, Window win, Window sibling, int mode) {
+	XWindowChanges wc;
+	int i, s;
+
+	if (sibling == None)
+		stackmove(win, stacktop == -1 ? None : stack[stacktop].win);
+	else if (mode == Above)
+		stackmove(win, sibling);
+	else {
+		s = windowindexget(stackindex, stackindexsize, sibling);
+		if (s != -1)
+			stackmove(win, stack[s].below == -1 ?
+				None : stack[stack[s].below].win);
+	}
+	i = windowindexget(stackindex, stackindexsize, win);
+	if (i != -1)
+		stack[i].serial = NextRequest(dsp);
+
+	if (sibling == None) {
+		XRaiseWindow(dsp, win);
+		return;
+	}
+	wc.sibling = sibling;
+	wc.stack_mode = mode;
+	XConfigureWindow(dsp, win, CWSibling | CWStackMode, &wc);
+}
+
+/*
+ * restack the override windows over the panel roof and a panel just under it
+ *
+ * the wanted order from the top is: the ontop override windows, the others
+ * and the roof; the roof stays where it is, and so do the windows over it in
+ * the longest sequence already in this order in the mirror; each other one is
+ * moved just above the one that follows it; the panel is then moved under the
+ * roof unless it is already there
+ */
+struct stackwant {
+	Window win;
+	int rank;
+	int length, prev;
+	Bool keep;
+} *stackwant = NULL;
+int maxstackwant = 0;
+void stackapply(Display *dsp, int pn) {
+	struct stackwant *w;
+	int n, i, j, k, best, roof, p;
+
+				/* wanted order */
+
+	if (! arrayfit((void **) &stackwant, &maxstackwant,
+			sizeof(struct stackwant), numoverride + 1))
+		return;
+	w = stackwant;
+	n = 0;
+	for (k = 1; k >= 0 && raiseoverride; k--)
+		for (i = overridelast[k]; i != -1; i = override[i].prev)
+			w[n++].win = override[i].win;
+	w[n++].win = panelroof;
+
+				/* positions in the current order */
+
+	for (i = stacktop, k = 0; i != -1; i = stack[i].below, k++)
+		stack[i].rank = k;
+	for (i = 0; i < n; i++) {
+		j = windowindexget(stackindex, stackindexsize, w[i].win);
+		w[i].rank = j == -1 ? -1 : stack[j].rank;
+	}
+	for (i = 0; i < n - 1; i++)
+		if (w[n - 1].rank != -1 && w[i].rank > w[n - 1].rank)
+			w[i].rank = -1;
+
+				/* longest sequence already in order */
+
+	best = -1;
+	for (i = 0; i < n; i++) {
+		w[i].length = w[i].rank == -1 ? 0 : 1;
+		w[i].prev = -1;
+		w[i].keep = False;
+		for (j = 0; j < i && w[i].length > 0; j++)
+			if (w[j].length > 0 && w[j].rank < w[i].rank &&
+			    w[j].length + 1 > w[i].length) {
+				w[i].length = w[j].length + 1;
+				w[i].prev = j;
+			}
+		if (w[i].length > 0 && (best == -1 ||
+		    w[i].length > w[best].length))
+			best = i;
+	}
+	if (w[n - 1].length > 0)
+		best = n - 1;
+	for (i = best; i != -1; i = w[i].prev)
+		w[i].keep = True;
+
+				/* move the others, from the bottom */
+
+	for (i = n - 1; i >= 0; i--) {
+		if (w[i].keep)
+			continue;
+		if (i < n - 1) {
+			logprintf("RESTACK 0x%lx above 0x%lx\n",
+				w[i].win, w[i + 1].win);
+			stackrequest(dsp, w[i].win, w[i + 1].win, Above);
+		}
+		else if (i > 0) {
+			logprintf("RESTACK 0x%lx below 0x%lx\n",
+				w[i].win, w[i - 1].win);
+			stackrequest(dsp, w[i].win, w[i - 1].win, Below);
+		}
+	}
+
+				/* the panel under the roof */
+
+	if (pn == -1)
+		return;
+	roof = windowindexget(stackindex, stackindexsize, panelroof);
+	p = windowindexget(stackindex, stackindexsize, panel[pn].panel);
+	if (roof != -1 && p != -1 && stack[roof].below == p)
+		return;
+	logprintf("RESTACK 0x%lx below 0x%lx\n", panel[pn].panel, panelroof);
+	stackrequest(dsp, panel[pn].panel, panelroof, Below);
 }
 
 /*
@@ -689,93 +2219,190 @@ void panelleave(Display *dsp, int pn) {
 
 	if (! unmaponleave && ! panel[pn].withdrawn)
 		return;
+	if (panel[pn].warm && ! panel[pn].withdrawn)
+		return;
+	panel[pn].warm = False;
 
 	XUnmapWindow(dsp, panel[pn].panel);
+	if (tombstoned(panel[pn].content))
+		return;
 	XUnmapWindow(dsp, panel[pn].content);
 
 	XDeleteProperty(dsp, panel[pn].content, wm_state);
 }
 
 /*
- * remove a panel
+ * warm panels: with unmaponleave, up to warmpanels panels are kept mapped just
+ * under the active one: the next, the previous, the one just left and then
+ * the further ones in the list; switching to them is only a restack and a
+ * change of focus, without the programs redrawing their windows from scratch
+ */
+#define MAXWARM 8
+int warm[MAXWARM], numwarm = 0;
+void panelwarm(Display *dsp, int pn, int prevpn) {
+	int candidate[MAXWARM], n, max, i, j, k, next, prev, above, s, p;
+
+	max = ! unmaponleave ? 0 : warmpanels > MAXWARM ? MAXWARM : warmpanels;
+	if (max > numactive - 1)
+		max = numactive - 1;
+
+				/* the panels to keep warm */
+
+	n = 0;
+	next = pn;
+	prev = pn;
+	for (k = 0; n < max && k < 2 * numactive; k++) {
+		if (k == 2 && prevpn != -1 && ! panel[prevpn].withdrawn)
+			i = prevpn;
+		else if (k % 2 == 0) {
+			do {
+				next = panelnext(next, 1);
+			} while (panel[next].withdrawn);
+			i = next;
+		}
+		else {
+			do {
+				prev = panelnext(prev, -1);
+			} while (panel[prev].withdrawn);
+			i = prev;
+		}
+		if (i == pn || tombstoned(panel[i].content))
+			continue;
+		for (j = 0; j < n; j++)
+			if (candidate[j] == i)
+				break;
+		if (j == n)
+			candidate[n++] = i;
+	}
+
+				/* cool down the panels no longer warm */
+
+	for (i = 0; i < numwarm; i++) {
+		k = warm[i];
+		if (k >= toppanels || panel[k].panel == None ||
+		    ! panel[k].warm)
+			continue;
+		for (j = 0; j < n; j++)
+			if (candidate[j] == k)
+				break;
+		if (j < n)
+			continue;
+		panel[k].warm = False;
+		if (k != prevpn && k != pn)
+			panelleave(dsp, k);
+	}
+
+				/* map the new ones under the active panel, in order */
+
+	for (i = 0; i < n; i++) {
+		k = candidate[i];
+		above = i == 0 ? pn : candidate[i - 1];
+		s = windowindexget(stackindex, stackindexsize,
+			panel[above].panel);
+		p = windowindexget(stackindex, stackindexsize, panel[k].panel);
+		if (s == -1 || p == -1 || stack[s].below != p)
+			stackrequest(dsp, panel[k].panel, panel[above].panel,
+				Below);
+		if (! panel[k].warm && k != prevpn) {
+			panelprint("WARM", k);
+			XMapWindow(dsp, panel[k].content);
+			XMapWindow(dsp, panel[k].panel);
+		}
+		panel[k].warm = True;
+		warm[i] = k;
+	}
+	numwarm = n;
+}
+
+/*
+ * destroy or withdraw a single panel, return whether it was the active one
+ */
+Bool paneldrop(Display *dsp, int pn, Bool destroy) {
+	Bool active;
+
+	active = activepanel == pn;
+	if (! panel[pn].withdrawn) {
+		numactive--;
+		mruunlink(pn);
+	}
+	if (destroy) {
+		panelprint("DESTROY", pn);
+		free(panel[pn].name);
+		free(panel[pn].label);
+		panelindexdelete(panelindex, panel[pn].panel);
+		panelindexdelete(panelindex, panel[pn].content);
+		groupremove(pn);
+		XDestroyWindow(dsp, panel[pn].panel);
+		panelunlink(pn, &firstpanel, &lastpanel);
+		panelrelease(pn);
+		numpanels--;
+	}
+	else if (! panel[pn].withdrawn) {
+		panelprint("WITHDRAW", pn);
+		panel[pn].withdrawn = True;
+		panelleave(dsp, pn);
+	}
+	return active;
+}
+
+/*
+ * remove a panel and the panels it leads
  */
 void panelremove(Display *dsp, int pn, Bool destroy) {
-	int i, j, n;
+	int i, next;
 	Window content;
+	Bool lost;
 
 	panelprint("REMOVE", pn);
-	if (pn < 0 || pn >= numpanels)
+	if (pn < 0 || pn >= toppanels || panel[pn].panel == None)
 		return;
 	content = panel[pn].content;
 	if (content == activecontent) {
 		activecontent = None;
-		printf("ACTIVECONTENT 0x%lx\n", activecontent);
-	}
-	if (pn == previouspanel)
-		previouspanel = -1;
-	if (previouspanel != -1) {
-		activepanel = previouspanel;
-		previouspanel = -1;
+		logprintf("ACTIVECONTENT 0x%lx\n", activecontent);
 	}
+	lost = False;
 
-	j = 0;
-	n = numpanels;
-	for (i = 0; i < n; i++) {
-		if (i == pn || panel[i].leader == content) {
-			if (! panel[i].withdrawn)
-				numactive--;
-			if (destroy) {
-				panelprint("DESTROY", i);
-				free(panel[i].name);
-				XDestroyWindow(dsp, panel[i].panel);
-				numpanels--;
-			}
-			else if (! panel[i].withdrawn) {
-				panelprint("WITHDRAW", i);
-				panel[i].withdrawn = True;
-				panelleave(dsp, i);
-			}
-			if (activepanel == j && numactive > 0) {
-				do {
-					MODULEINCREASE(activepanel,
-						numpanels, -1);
-				}
-				while (panel[activepanel].withdrawn);
-			}
-			if (destroy) {
-				if (activepanel > j)
-					activepanel--;
-				continue;
-			}
-		}
-		if (j != i) {
-			printf("PANEL %d BECOMES PANEL %d\n", i, j);
-			panel[j] = panel[i];
-			paneltitle(dsp, j);
-		}
-		j++;
+	for (i = groupfirst(content); i != -1; i = next) {
+		next = panel[i].groupnext;
+		if (i != pn)
+			lost = paneldrop(dsp, i, destroy) || lost;
 	}
+	lost = paneldrop(dsp, pn, destroy) || lost;
 
 	if (numactive == 0)
 		activepanel = -1;
+	else if (lost)
+		activepanel = firstmru;
 }
 
 /*
- * swap panels
+ * remove all panels whose content is destroyed, return how many
  */
-int panelswap(int pn1, int pn2) {
-	struct panel temp;
-
-	if (pn1 == -1 || pn1 > numpanels - 2)
-		return -1;
-	if (pn2 == -1 || pn2 > numpanels - 1)
-		return -1;
+int panelreap(Display *dsp) {
+	int pn, next, n;
 
-	temp = panel[pn2];
-	panel[pn2] = panel[pn1];
-	panel[pn1] = temp;
+	n = 0;
+	for (pn = firstpanel; pn != -1; pn = next) {
+		next = panel[pn].next;
+		if (! tombstoned(panel[pn].content))
+			continue;
+		while (next != -1 && panel[next].leader == panel[pn].content)
+			next = panel[next].next;	/* removed with pn */
+		panelremove(dsp, pn, True);
+		n++;
+	}
+	return n;
+}
 
-	return 0;
+/*
+ * move a panel at the end of the list
+ */
+void panelmoveend(int pn) {
+	if (pn == -1 || pn == lastpanel)
+		return;
+	panelunlink(pn, &firstpanel, &lastpanel);
+	panelappend(pn, &firstpanel, &lastpanel);
 }
 
 /*
@@ -793,37 +2420,74 @@ void panelresize(Display *dsp, XWindowAttributes base, int pn) {
 
 /*
  * update the lists of managed windows
+ *
+ * the published values are kept in persistent buffers, and only the ones that
+ * changed are written; a list that only grew at the end is appended to
  */
+struct clientlist {
+	Atom *property;
+	Window *list;
+	int num, max;
+	Bool valid;		/* the list matches the property */
+} clientlist = {&net_client_list, NULL, 0, 0, False},
+  clientstacking = {&net_client_list_stacking, NULL, 0, 0, False};
+Window clientactive = None;
+Bool clientactivevalid = False;
+void clientlistset(struct clientlist *c, int n, Window win) {
+	if (n < c->num && c->list[n] == win)
+		return;
+	if (n < c->num)
+		c->valid = False;
+	c->list[n] = win;
+}
+void clientlistpublish(Display *dsp, Window root,
+		struct clientlist *c, int n) {
+	if (c->valid && n == c->num)
+		return;
+	if (c->valid && n > c->num)
+		XChangeProperty(dsp, root, *c->property,
+			XA_WINDOW, 32, PropModeAppend,
+			(unsigned char *) (c->list + c->num), n - c->num);
+	else
+		XChangeProperty(dsp, root, *c->property,
+			XA_WINDOW, 32, PropModeReplace,
+			(unsigned char *) c->list, n);
+	c->num = n;
+	c->valid = True;
+}
 void clientlistupdate(Display *dsp, Window root) {
-	Window *list, *slist;
-	int i, j, k, l, n;
-
-	XChangeProperty(dsp, root, net_active_window,
-		XA_WINDOW, 32, PropModeReplace,
-		(unsigned char *) &activewindow, 1);
+	int i, k, l, n;
+
+	if (! clientactivevalid || clientactive != activewindow)
+		XChangeProperty(dsp, root, net_active_window,
+			XA_WINDOW, 32, PropModeReplace,
+			(unsigned char *) &activewindow, 1);
+	clientactive = activewindow;
+	clientactivevalid = True;
+
+	if (! arrayfit((void **) &clientlist.list, &clientlist.max,
+			sizeof(Window), numpanels) ||
+	    ! arrayfit((void **) &clientstacking.list, &clientstacking.max,
+			sizeof(Window), numpanels))
+		return;
 
-	list = malloc(numpanels * sizeof(Window));
-	slist = malloc(numpanels * sizeof(Window));
 	n = 0;
-	j = 0;
+	for (i = firstpanel; i != -1; i = panel[i].next)
+		if (! panel[i].withdrawn)
+			clientlistset(&clientlist, n++, panel[i].content);
 	l = 0;
+	k = activepanel == -1 ? lastpanel : activepanel;
 	for (i = 0; i < numpanels; i++) {
-		if (! panel[i].withdrawn) {
-			list[j++] = panel[i].content;
-			n++;
-		}
-		k = (activepanel + 1 + i) % numpanels;
+		k = panelnext(k, 1);
 		if (! panel[k].withdrawn)
-			slist[l++] = panel[k].content;
+			clientlistset(&clientstacking, l++, panel[k].content);
 	}
-	XChangeProperty(dsp, root, net_client_list,
-		XA_WINDOW, 32, PropModeReplace,
-		(unsigned char *) list, n);
-	XChangeProperty(dsp, root, net_client_list_stacking,
-		XA_WINDOW, 32, PropModeReplace,
-		(unsigned char *) slist, n);
-	free(list);
-	free(slist);
+	if (n < clientlist.num)
+		clientlist.valid = False;
+	if (l < clientstacking.num)
+		clientstacking.valid = False;
+	clientlistpublish(dsp, root, &clientlist, n);
+	clientlistpublish(dsp, root, &clientstacking, l);
 }
 
 /*
@@ -831,14 +2495,12 @@ void clientlistupdate(Display *dsp, Window root) {
  */
 void panelenter(Display *dsp, Window root, int prevpn, int pn) {
 	long data[2];
-	XWindowChanges wc;
 
 	if (pn == -1) {
 		activecontent = None;
-		printf("ACTIVECONTENT 0x%lx\n", activecontent);
+		logprintf("ACTIVECONTENT 0x%lx\n", activecontent);
 		panelleave(dsp, prevpn);
 		XSetInputFocus(dsp, root, RevertToParent, CurrentTime);
-		previouspanel = activepanel;
 		activepanel = pn;
 		clientlistupdate(dsp, root);
 		return;
@@ -846,9 +2508,13 @@ void panelenter(Display *dsp, Window root, int prevpn, int pn) {
 
 	panelprint("ENTER", pn);
 
-	if (pn >= numpanels) {
-		printf("WARNING: panel number %d not less than numpanels=%d\n",
-			pn, numpanels);
+	if (pn >= toppanels || panel[pn].panel == None) {
+		logprintf("WARNING: panel number %d is not in use\n", pn);
+		return;
+	}
+
+	if (tombstoned(panel[pn].content)) {
+		logprintf("NOTE: content of panel %d is destroyed\n", pn);
 		return;
 	}
 
@@ -856,32 +2522,34 @@ void panelenter(Display *dsp, Window root, int prevpn, int pn) {
 		panelprint("RESTORE", pn);
 		panel[pn].withdrawn = False;
 		numactive++;
+		mruappend(pn);
 	}
+	mrupush(pn);
 
 	if (activecontent == panel[pn].content) {
-		printf("NOTE: active content already active\n");
-		previouspanel = activepanel;
+		logprintf("NOTE: active content already active\n");
 		activepanel = pn;
 		clientlistupdate(dsp, root);
 		return;
 	}
 
-	wc.sibling = panelroof;
-	wc.stack_mode = Below;
-	XConfigureWindow(dsp, panel[pn].panel, CWSibling | CWStackMode, &wc);
-	overrideraise(dsp);
+	stackapply(dsp, pn);
 
-	XMapWindow(dsp, panel[pn].content);
-	XMapWindow(dsp, panel[pn].panel);
+	if (panel[pn].warm)
+		panel[pn].warm = False;
+	else {
+		XMapWindow(dsp, panel[pn].content);
+		XMapWindow(dsp, panel[pn].panel);
+	}
 
+	panelwarm(dsp, pn, prevpn);
 	panelleave(dsp, prevpn);
 
-	previouspanel = activepanel;
 	activepanel = pn;
 	activecontent = panel[pn].content;
-	printf("ACTIVECONTENT 0x%lx\n", activecontent);
+	logprintf("ACTIVECONTENT 0x%lx\n", activecontent);
 	activewindow = panel[pn].content;
-	printf("ACTIVEWINDOW 0x%lx\n", activewindow);
+	logprintf("ACTIVEWINDOW 0x%lx\n", activewindow);
 	clientlistupdate(dsp, root);
 
 	data[0] = NormalState;
@@ -890,19 +2558,21 @@ void panelenter(Display *dsp, Window root, int prevpn, int pn) {
 		32, PropModeReplace, (unsigned char *) data, 2);
 
 	XSetInputFocus(dsp, panel[pn].content, RevertToParent, CurrentTime);
+	lirclatency("focus");
 }
 
 /*
  * switch to next/previous panel
  */
 int panelswitch(Display *dsp, Window root, int rel) {
-	int pn;
-	if (activepanel == -1)
+	int pn, i;
+	if (activepanel == -1 || numactive == 0)
 		return -1;
 	pn = activepanel;
-	do {
-		MODULEINCREASE(pn, numpanels, rel);
-	} while (panel[pn].withdrawn);
+	for (i = 0; i < abs(rel); i++)
+		do {
+			pn = panelnext(pn, rel);
+		} while (panel[pn].withdrawn);
 	panelenter(dsp, root, activepanel, pn);
 	return 0;
 }
@@ -924,6 +2594,7 @@ typedef struct {
 	Window window;
 	GC gc;
 	int width;
+	Bool mapped;		/* as last requested */
 #ifndef XFT
 	XFontStruct *font;
 #else
@@ -943,12 +2614,61 @@ void drawstring(Display *dsp, ListWindow *lw, int x, int *y, char *s) {
 	XDrawString(dsp, lw->window, lw->gc, x, *y, s, strlen(s));
 #else
 	dsp = dsp;	/* avoid warning for unused variable */
-	XftDrawString8(lw->draw, &lw->color, lw->font, x, *y,
+	XftDrawStringUtf8(lw->draw, &lw->color, lw->font, x, *y,
 		(unsigned char *) s, strlen(s));
 #endif
 	*y += lw->font->descent + PADDING;
 }
 
+/*
+ * width of the first len bytes of a string
+ */
+int stringwidth(Display *dsp, ListWindow *lw, char *s, int len) {
+#ifndef XFT
+	dsp = dsp;	/* avoid warning for unused variable */
+	return XTextWidth(lw->font, s, len);
+#else
+	XGlyphInfo extents;
+	XftTextExtentsUtf8(dsp, lw->font, (unsigned char *) s, len, &extents);
+	return extents.xOff;
+#endif
+}
+
+/*
+ * a copy of a utf-8 string cut at a character boundary to fit a width; the
+ * core fonts are latin-1, so without XFT the copy is converted to it
+ */
+#define ELLIPSIS "..."
+#ifdef XFT
+#define CONTINUATION(c) (((c) & 0xC0) == 0x80)
+#else
+#define CONTINUATION(c) False
+#endif
+char *stringfit(Display *dsp, ListWindow *lw, char *s, int width) {
+	int len, e;
+	char *f;
+
+#ifdef XFT
+	f = strdup(s);
+#else
+	f = utf8tolatin1(s);
+#endif
+	len = strlen(f);
+	if (stringwidth(dsp, lw, f, len) <= width)
+		return f;
+
+	e = stringwidth(dsp, lw, ELLIPSIS, strlen(ELLIPSIS));
+	do {
+		do {
+			len--;
+		} while (len > 0 && CONTINUATION(f[len]));
+	} while (len > 0 && stringwidth(dsp, lw, f, len) + e > width);
+
+	f = realloc(f, len + strlen(ELLIPSIS) + 1);
+	strcpy(f + len, ELLIPSIS);
+	return f;
+}
+
 /*
  * draw a separator
  */
@@ -981,16 +2701,31 @@ void drawarrow(Display* dsp, ListWindow *lw, int *y, Bool draw, Bool up) {
 	*y += lw->font->descent + PADDING;
 }
 
+/*
+ * move the selection in a list of n elements: steps wrap around the ends of
+ * the list, so that a merged or accelerated step lands where as many single
+ * steps would; pages stop at the ends
+ */
+int listmove(int selected, int n, int rel, Bool page) {
+	if (n <= 0)
+		return 0;
+	if (! page)
+		return ((selected + rel) % n + n) % n;
+	selected += rel;
+	return selected < 0 ? 0 : selected >= n ? n - 1 : selected;
+}
+
 /*
  * draw a list with a selected element
  */
 #define MARGIN 5
+#define LISTROWS 9
 void drawlist(Display *dsp, ListWindow *lw,
 		char *title, char *elements[], int selected, char *help[]) {
 	int x, y, z, w;
 	int start, i;
 	Bool stop;
-	char buf[100];
+	char buf[400];
 
 	x = MARGIN;
 	y = MARGIN;
@@ -998,12 +2733,12 @@ void drawlist(Display *dsp, ListWindow *lw,
 	drawstring(dsp, lw, x, &y, title);
 	drawseparator(dsp, lw, &y);
 
-	start = selected <= 4 ? 0 : selected - 4;
+	start = selected <= LISTROWS / 2 ? 0 : selected - LISTROWS / 2;
 	stop = False;
 
 	drawarrow(dsp, lw, &y, start > 0, True);
 
-	for (i = start; i < start + 9; i++) {
+	for (i = start; i < start + LISTROWS; i++) {
 		if (! stop && ! elements[i])
 			stop = True;
 		if (stop) {
@@ -1017,7 +2752,7 @@ void drawlist(Display *dsp, ListWindow *lw,
 			XDrawRectangle(dsp, lw->window, lw->gc, x, y, z, w);
 		}
 
-		snprintf(buf, 100, "%2d %s", i + 1, elements[i]);
+		snprintf(buf, 400, "%2d %s", i + 1, elements[i]);
 		drawstring(dsp, lw, x + PADDING, &y, buf);
 	}
 
@@ -1030,32 +2765,51 @@ void drawlist(Display *dsp, ListWindow *lw,
 }
 
 /*
- * draw the panel list window
+ * draw the panel list window; the labels are recomputed when their width or
+ * the font changes
  */
+int labelwidth = -1;
+void *labelfont = NULL;
 void drawpanel(Display *dsp, ListWindow *lw, int activepanel) {
-	int i, j, a;
+	int i, j, a, width;
 	char **elements;
 	char *help[] = {"enter: ok",
 			"escape: ok",
 			"c: close window",
 			"e: move window at end",
+			"m: recently used first",
 			NULL};
 
+	width = lw->width - 2 * MARGIN - PADDING -
+		stringwidth(dsp, lw, "99 ", 3);
+	if (width != labelwidth || (void *) lw->font != labelfont) {
+		for (i = firstpanel; i != -1; i = panel[i].next) {
+			free(panel[i].label);
+			panel[i].label = NULL;
+		}
+		labelwidth = width;
+		labelfont = lw->font;
+	}
+
 	elements = malloc((numactive + 1) * sizeof(char *));
 	a = 0;
 	j = 0;
-	for (i = 0; i < numpanels; i++) {
-		if (panel[i].withdrawn)
-			continue;
+	for (i = panelfirst(); i != -1; i = panelfollowing(i)) {
 		if (i == activepanel)
 			a = j;
-		panelname(dsp, i);
-		elements[j] = panel[i].name;
+		if (panel[i].label == NULL)
+			panel[i].label = stringfit(dsp, lw, panel[i].name,
+				width);
+		elements[j] = panel[i].label;
 		j++;
 	}
 	elements[numactive] = NULL;
 
-	drawlist(dsp, lw, IRWM ": panel list", elements, a, help);
+	if (mruorder)
+		help[4] = "m: list order";
+	drawlist(dsp, lw,
+		mruorder ? IRWM ": recent panels" : IRWM ": panel list",
+		elements, a, help);
 	free(elements);
 }
 
@@ -1090,42 +2844,267 @@ void drawconfirm(Display *dsp, ListWindow *cw, int selected) {
 	drawlist(dsp, cw, IRWM ": confirm quit", elements, selected, help);
 }
 
+/*
+ * raise the mapped list windows, unless they are already the top windows in
+ * the stacking order; the last ones stay over the first; the mirror is updated
+ * at once, so that a second call before the events makes no request
+ */
+void stacklists(Display *dsp,
+		ListWindow *panels, ListWindow *confirm, ListWindow *progs) {
+	ListWindow *list[] = {progs, confirm, panels};
+	int i, j;
+
+	for (i = 0, j = stacktop; i < 3; i++) {
+		if (! list[i]->mapped)
+			continue;
+		if (j == -1 || stack[j].win != list[i]->window)
+			break;
+		j = stack[j].below;
+	}
+	if (i == 3)
+		return;
+	for (i = 2; i >= 0; i--)
+		if (list[i]->mapped)
+			stackrequest(dsp, list[i]->window, None, Above);
+}
+
 /*
  * clear the panel list window and raise the list windows, if any is mapped
  */
 void raiselists(Display *dsp,
 		ListWindow *panels, ListWindow *confirm, ListWindow *progs) {
-	XClearArea(dsp, panels->window, 0, 0, 0, 0, True);
-	XRaiseWindow(dsp, panels->window);
-	XRaiseWindow(dsp, confirm->window);
-	XRaiseWindow(dsp, progs->window);
+	if (panels->mapped)
+		XClearArea(dsp, panels->window, 0, 0, 0, 0, True);
+	stacklists(dsp, panels, confirm, progs);
+}
+
+/*
+ * map or unmap a list window if not already, return whether it was mapped
+ */
+Bool showlist(Display *dsp, ListWindow *lw, Bool show) {
+	if (lw->mapped == show)
+		return False;
+	lw->mapped = show;
+	if (show)
+		XMapWindow(dsp, lw->window);
+	else
+		XUnmapWindow(dsp, lw->window);
+	return show;
+}
+
+/*
+ * grab or ungrab the keyboard if not already; a failed grab is retried the
+ * next time
+ */
+Bool keyboardgrabbed = False;
+void grabkeyboard(Display *dsp, Window root, Bool grab) {
+	if (grab == keyboardgrabbed)
+		return;
+	if (! grab) {
+		XUngrabKeyboard(dsp, CurrentTime);
+		keyboardgrabbed = False;
+		return;
+	}
+	keyboardgrabbed = ROUNDTRIP(XGrabKeyboard(dsp, root, False,
+		GrabModeAsync, GrabModeAsync, CurrentTime)) == GrabSuccess;
+	if (! keyboardgrabbed)
+		logprintf("WARNING: cannot grab the keyboard\n");
+}
+
+/*
+ * batches of events
+ *
+ * the pending events are read all together and coalesced before being
+ * processed: a ConfigureNotify or an Expose followed by another for the same
+ * window is dropped, and so are the events on windows destroyed later in the
+ * batch; switching panel and raising the list windows are postponed to the
+ * end of the batch, so that they are done at most once per batch
+ */
+#define MAXBATCH 64
+int batchenter = -1;		/* panel to switch to at the end of the batch */
+Bool batchrefocus = False;	/* enter the active panel again */
+Bool batchraise = False;	/* raise the list windows */
+Bool batchreap = False;		/* remove the panels of destroyed windows */
+
+/*
+ * the window an event is about, for coalescing
+ */
+Window eventwindow(XEvent *e) {
+	switch (e->type) {
+	case MapRequest:
+		return e->xmaprequest.window;
+	case ConfigureRequest:
+		return e->xconfigurerequest.window;
+	case CreateNotify:
+		return e->xcreatewindow.window;
+	case ConfigureNotify:
+		return e->xconfigure.window;
+	case MapNotify:
+		return e->xmap.window;
+	case DestroyNotify:
+		return e->xdestroywindow.window;
+	case PropertyNotify:
+		return e->xproperty.window;
+	case Expose:
+		return e->xexpose.window;
+	default:
+		return None;
+	}
+}
+
+/*
+ * the property a PropertyNotify is about, for coalescing: a change of either
+ * WM_NAME or _NET_WM_NAME makes irwm read both
+ */
+Atom eventproperty(XEvent *e) {
+	return e->xproperty.atom == net_wm_name ? XA_WM_NAME : e->xproperty.atom;
+}
+
+/*
+ * whether an event is made useless by a later one
+ */
+Bool eventsuperseded(XEvent *e, XEvent *later) {
+	Window win;
+
+	win = eventwindow(e);
+	if (win == None || eventwindow(later) != win)
+		return False;
+	if (later->type == DestroyNotify && e->type != DestroyNotify)
+		return True;
+	if (e->type == PropertyNotify && later->type == PropertyNotify)
+		return eventproperty(e) == eventproperty(later);
+	return e->type == later->type &&
+		(e->type == ConfigureNotify || e->type == Expose);
+}
+
+/*
+ * coalesce a batch of events, return the number of remaining ones
+ */
+int batchcoalesce(XEvent *batch, struct timespec *time, int n) {
+	int i, j, k;
+
+	for (i = 0, k = 0; i < n; i++) {
+		for (j = i + 1; j < n; j++)
+			if (eventsuperseded(&batch[i], &batch[j]))
+				break;
+		if (j < n) {
+			logprintf("[%ld] %s\n\t0x%lx coalesced\n",
+				batch[i].xany.serial,
+				eventname[batch[i].type],
+				eventwindow(&batch[i]));
+			continue;
+		}
+		batch[k] = batch[i];
+		time[k] = time[i];
+		k++;
+	}
+	return k;
+}
+
+/*
+ * switch to a panel at the end of the batch
+ */
+void batchswitch(int pn) {
+	if (pn == activepanel) {
+		batchenter = -1;
+		return;
+	}
+	batchenter = pn;
+	batchrefocus = False;
+}
+
+/*
+ * skip the keystrokes and messages for the forward and backward commands that
+ * come next in the batch, like NEXTPANEL and PREVPANEL, return the resulting
+ * relative jump; key releases in between are skipped as well
+ */
+int batchmerge(XEvent *batch, int *next, int len,
+		Atom irwm, Bool shortcuts, int forward, int backward) {
+	int rel, i, command;
+	XEvent *e;
+
+	rel = 0;
+	for (i = *next; i < len; i++) {
+		e = &batch[i];
+		if (e->type == KeyRelease)
+			continue;
+		if (e->type == KeyPress)
+			command = eventtocommand(e->xkey, shortcuts);
+		else if (e->type == ClientMessage &&
+		         e->xclient.message_type == irwm &&
+		         e->xclient.format == 32)
+			command = e->xclient.data.l[0];
+		else
+			break;
+		if (command != forward && command != backward)
+			break;
+		logprintf("[%ld] %s\n\tMERGED %s\n", e->xany.serial,
+			eventname[e->type], commandtostring(command));
+		rel += command == backward ? -1 : 1;
+		*next = i + 1;
+	}
+	return rel;
+}
+
+/*
+ * execute the actions postponed to the end of the batch; a switch to a panel
+ * that still exists wins over refocusing the active one; the panel array may
+ * have shrunk since the switch was postponed
+ */
+void batchflush(Display *dsp, Window root,
+		ListWindow *panels, ListWindow *confirm, ListWindow *progs) {
+	int active;
+
+	active = activepanel;
+	if (batchreap && panelreap(dsp) > 0 && activepanel != active)
+		batchrefocus = True;
+	if (batchenter != -1 && (batchenter >= toppanels ||
+	    panel[batchenter].panel == None || panel[batchenter].withdrawn))
+		batchenter = -1;
+	if (batchenter != -1 && (batchrefocus || batchenter != activepanel))
+		panelenter(dsp, root, batchrefocus ? -1 : activepanel,
+			batchenter);
+	else if (batchrefocus)
+		panelenter(dsp, root, -1, activepanel);
+	if (batchraise || batchrefocus || batchenter != -1)
+		raiselists(dsp, panels, confirm, progs);
+	batchenter = -1;
+	batchrefocus = False;
+	batchraise = False;
+	batchreap = False;
+	XFlush(dsp);
 }
 
 /*
- * close a window; called when pressing 'c' in the panel list
+ * close the window of a panel; called when pressing 'c' in the panel list;
+ * WM_PROTOCOLS is only retrieved if not already known
  */
-void closewindow(Display *dsp, Window win) {
+void closewindow(Display *dsp, int pn) {
 	XEvent message;
+	Window win;
 	Atom *props;
 	int numprops, i;
-	Bool delete = False;
 
-	if (XGetWMProtocols(dsp, win, &props, &numprops)) {
-		for (i = 0; i < numprops; i++)
-			if (props[i] == wm_delete_window) {
-				delete = True;
-				break;
-			}
-		XFree(props);
+	win = panel[pn].content;
+	if (tombstoned(win))
+		return;
+	if (panel[pn].deletewindow == -1) {
+		panel[pn].deletewindow = False;
+		if (ROUNDTRIP(XGetWMProtocols(dsp, win, &props, &numprops))) {
+			for (i = 0; i < numprops; i++)
+				if (props[i] == wm_delete_window)
+					panel[pn].deletewindow = True;
+			XFree(props);
+		}
 	}
 
-	if (! delete) {
-		printf("xkillclient 0x%lx\n", win);
+	if (! panel[pn].deletewindow) {
+		logprintf("xkillclient 0x%lx\n", win);
 		XKillClient(dsp, win);
 		return;
 	}
 
-	printf("wm_delete_window message to 0x%lx\n", win);
+	logprintf("wm_delete_window message to 0x%lx\n", win);
 	memset(&message, 0, sizeof(message));
 	message.type = ClientMessage;
 	message.xclient.window = win;
@@ -1147,19 +3126,25 @@ void capturetop(Display *dsp, Window root) {
 	XCreateWindowEvent cw;
 	unsigned long msk = SubstructureRedirectMask | SubstructureNotifyMask;
 
-	XQueryTree(dsp, root, &rr, &pr, &top, &ntop);
+	ROUNDTRIP(XQueryTree(dsp, root, &rr, &pr, &top, &ntop));
 	for (i = 0; i < ntop; i++) {
-		XGetWindowAttributes(dsp, top[i], &wa);
+		stackadd(top[i]);
+		ROUNDTRIP(XGetWindowAttributes(dsp, top[i], &wa));
 		if (wa.override_redirect) {
-			printf("CAPTURE OVERRIDE 0x%lx\n", top[i]);
+			logprintf("CAPTURE OVERRIDE 0x%lx\n", top[i]);
 			cw.type = CreateNotify;
 			cw.window = top[i];
 			cw.parent = root;
 			cw.override_redirect = True;
+			cw.x = wa.x;
+			cw.y = wa.y;
+			cw.width = wa.width;
+			cw.height = wa.height;
+			cw.border_width = wa.border_width;
 			XSendEvent(dsp, root, False, msk, (XEvent *) &cw);
 		}
 		else if (wa.map_state != IsUnmapped) {
-			printf("CAPTURE 0x%lx\n", top[i]);
+			logprintf("CAPTURE 0x%lx\n", top[i]);
 			mr.type = MapRequest;
 			mr.window = top[i];
 			XSendEvent(dsp, root, False, msk, (XEvent *) &mr);
@@ -1171,11 +3156,14 @@ void capturetop(Display *dsp, Window root) {
 /*
  * main
  */
+#define MAXREADY 10
 int main(int argn, char *argv[]) {
 	char **cargv;
 	int cargn;
-	char *logfile = "irwm.log";
+	char *logfile = NULL;
+	char *tracefile = NULL;
 	int lf;
+	struct sigaction sa;
 
 	char *irwmrcname;
 	FILE *irwmrc;
@@ -1203,17 +3191,19 @@ int main(int argn, char *argv[]) {
 	int pn;
 	char *message;
 	int i, j, c, w;
-	Bool tran;
+	struct windowinfo info;
 	KeySym shortcuts[100];
 	Cursor cursorlog, cursornormal;
 
 	Bool startprogs = True, uselirc = False, singlekey = False;
+	Bool asynclog = False;
 	Bool overridefix = False;
 	Bool quitonlastclose = False, confirmquit = False;
 	Bool run, restart, retire, stickaround = False;
 	Bool grabtoggle = False, grab = True;
-	int command;
+	int command, redirect = NOCOMMAND, issued;
 	Bool showpanel = False, showprogs = False, showconfirm = False;
+	Bool page;
 	int progselected = 0, confirmselected = 0;
 	char *p, *t;
 
@@ -1228,6 +3218,22 @@ int main(int argn, char *argv[]) {
 	XErrorEvent err;
 	char numstring[50], errortext[2000];
 
+	sigset_t sigs;
+	struct signalfd_siginfo si;
+	int epfd, sigfd, logtimer, lircfd;
+	struct lirc_config *lircconfig = NULL;
+	struct epoll_event ready[MAXREADY];
+	int nready, pending;
+	XEvent batch[MAXBATCH];
+	struct timespec batchtime[MAXBATCH];
+	int batchlen, batchnext;
+	int rel;
+	struct timespec received;
+	unsigned long requests, sync;
+	Window logwin = None;
+
+	logstream = stdout;
+
 				/* parse options */
 
 	cargv = malloc((argn + 2) * sizeof(char *));
@@ -1240,6 +3246,8 @@ int main(int argn, char *argv[]) {
 			quitonlastclose = True;
 		else if (! strcmp(argv[1], "-c"))
 			confirmquit = True;
+		else if (! strcmp(argv[1], "-a"))
+			asynclog = True;
 		else if (! strcmp(argv[1], "-n"))
 			startprogs = False;
 		else if (! strcmp(argv[1], "-s"))
@@ -1248,9 +3256,18 @@ int main(int argn, char *argv[]) {
 			unmaponleave = True;
 		else if (! strcmp(argv[1], "-r"))
 			unmaponleave = False;
+		else if (! strcmp(argv[1], "-w")) {
+			if (argn - 1 < 2) {
+				logprintf("error: -w requires value\n");
+				exit(EXIT_FAILURE);
+			}
+			warmpanels = atoi(argv[2]);
+			argn--;
+			argv++;
+		}
 		else if (! strcmp(argv[1], "-display")) {
 			if (argn - 1 < 2) {
-				printf("error: -display requires value\n");
+				logprintf("error: -display requires value\n");
 				exit(EXIT_FAILURE);
 			}
 			displayname = argv[2];
@@ -1259,7 +3276,7 @@ int main(int argn, char *argv[]) {
 		}
 		else if (! strcmp(argv[1], "-geometry")) {
 			if (argn - 1 < 2) {
-				printf("error: -geometry requires value\n");
+				logprintf("error: -geometry requires value\n");
 				exit(EXIT_FAILURE);
 			}
 			irwa = malloc(sizeof(XWindowAttributes));
@@ -1271,7 +3288,7 @@ int main(int argn, char *argv[]) {
 		}
 		else if (! strcmp(argv[1], "-fn")) {
 			if (argn - 1 < 2) {
-				printf("error: -fn requires value\n");
+				logprintf("error: -fn requires value\n");
 				exit(EXIT_FAILURE);
 			}
 			fontname = argv[2];
@@ -1280,16 +3297,25 @@ int main(int argn, char *argv[]) {
 		}
 		else if (! strcmp(argv[1], "-log")) {
 			if (argn - 1 < 2) {
-				printf("error: -log requires value\n");
+				logprintf("error: -log requires value\n");
 				exit(EXIT_FAILURE);
 			}
 			logfile = argv[2];
 			argn--;
 			argv++;
 		}
+		else if (! strcmp(argv[1], "-trace")) {
+			if (argn - 1 < 2) {
+				logprintf("error: -trace requires value\n");
+				exit(EXIT_FAILURE);
+			}
+			tracefile = argv[2];
+			argn--;
+			argv++;
+		}
 		else if (! strcmp(argv[1], "-lircrc")) {
 			if (argn - 1 < 2) {
-				printf("error: -lircrc requires value\n");
+				logprintf("error: -lircrc requires value\n");
 				exit(EXIT_FAILURE);
 			}
 			lircrc = argv[2];
@@ -1298,21 +3324,28 @@ int main(int argn, char *argv[]) {
 		}
 		else {
 			if (! ! strcmp(argv[1], "-h"))
-				printf("unrecognized option: %s\n", argv[1]);
-			printf("usage:\n");
-			printf("\txinit irwm [options]\n");
-			printf("\tstartx irwm [options]\n");
-			printf("options:\n");
-			printf("\t-l\t\t\tuse lirc for input\n");
-			printf("\t-q\t\t\tquit when all windows are closed\n");
-			printf("\t-c\t\t\tconfirm quit if a window is open\n");
-			printf("\t-n\t\t\tdo not start programs in .irwmrc\n");
-			printf("\t-r\t\t\tswitch to window by raising it\n");
-			printf("\t-u\t\t\tswitch by unmapping previous\n");
-			printf("\t-display display\tconnect to server\n");
-			printf("\t-geometry WxH+X+Y\tgeometry of windows\n");
-			printf("\t-fn font\t\tfont used in lists\n");
-			printf("\t-log file\t\tlog to file\n");
+				logprintf("unrecognized option: %s\n", argv[1]);
+			logprintf("usage:\n");
+			logprintf("\txinit irwm [options]\n");
+			logprintf("\tstartx irwm [options]\n");
+			logprintf("options:\n");
+			logprintf("\t-l\t\t\tuse lirc for input\n");
+			logprintf(
+				"\t-q\t\t\tquit when all windows are closed\n");
+			logprintf(
+				"\t-c\t\t\tconfirm quit if a window is open\n");
+			logprintf(
+				"\t-n\t\t\tdo not start programs in .irwmrc\n");
+			logprintf("\t-a\t\t\tlog from a separate thread\n");
+			logprintf("\t-r\t\t\tswitch to window by raising it\n");
+			logprintf("\t-u\t\t\tswitch by unmapping previous\n");
+			logprintf(
+				"\t-w n\t\t\twith -u, keep n panels mapped\n");
+			logprintf("\t-display display\tconnect to server\n");
+			logprintf("\t-geometry WxH+X+Y\tgeometry of windows\n");
+			logprintf("\t-fn font\t\tfont used in lists\n");
+			logprintf("\t-log file\t\tlog to file\n");
+			logprintf("\t-trace file\t\tbinary trace to file\n");
 			exit(! strcmp(argv[1], "-h") ?
 				EXIT_SUCCESS : EXIT_FAILURE);
 		}
@@ -1322,7 +3355,13 @@ int main(int argn, char *argv[]) {
 
 				/* configuration file */
 
-	signal(SIGCHLD, reaper);
+	sigemptyset(&sigs);
+	sigaddset(&sigs, SIGCHLD);
+	sigaddset(&sigs, SIGUSR1);
+	sigprocmask(SIG_BLOCK, &sigs, NULL);
+	sigfd = signalfd(-1, &sigs, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (sigfd == -1)
+		perror("signalfd");
 
 	irwmrcname = malloc(strlen(getenv("HOME")) + 20);
 	sprintf(irwmrcname, "%s/.irwmrc", getenv("HOME"));
@@ -1331,7 +3370,7 @@ int main(int argn, char *argv[]) {
 	if (irwmrc == NULL)
 		irwmrc = fopen("/etc/irwmrc", "r");
 	if (irwmrc == NULL) {
-		printf("WARNING: cannot read /etc/irwmrc or .irwmrc\n");
+		logprintf("WARNING: cannot read /etc/irwmrc or .irwmrc\n");
 
 		numprograms = 0;
 		programs[numprograms].title = "xterm";
@@ -1360,17 +3399,31 @@ int main(int argn, char *argv[]) {
 			else if (1 == sscanf(line, "%s", s1) &&
 			     ! strcmp(s1, "positionfix"))
 				overridefix = True;
+			else if (1 == sscanf(line, "%s", s1) &&
+			     ! strcmp(s1, "asynclog"))
+				asynclog = True;
+			else if (1 == sscanf(line, "%s", s1) &&
+			     ! strcmp(s1, "mrulist"))
+				mruorder = True;
 			else if (1 == sscanf(line, "echo %[^\n]", s1))
-				printf("%s\n", s1);
+				logprintf("%s\n", s1);
 			else if (1 == sscanf(line, "font %s", s1)) {
 				if (fontname == NULL)
 					fontname = strdup(s1);
 			}
 			else if (1 == sscanf(line, "logfile %s", s1))
 				logfile = strdup(s1);
+			else if (1 == sscanf(line, "trace %s", s1)) {
+				if (tracefile == NULL)
+					tracefile = strdup(s1);
+			}
 			else if (1 == sscanf(line, "%s", s1) &&
 			         ! strcmp(s1, "unmaponleave"))
 				unmaponleave = True;
+			else if (1 == sscanf(line, "warm %d", &i)) {
+				if (warmpanels == 0)
+					warmpanels = i;
+			}
 			else if (1 == sscanf(line, "%s", s1) &&
 			         ! strcmp(s1, "stickaround"))
 				stickaround = True;
@@ -1380,7 +3433,7 @@ int main(int argn, char *argv[]) {
 					forkprogram(s1, NULL);
 				}
 				else
-					printf("ignored (-n): %s", line);
+					logprintf("ignored (-n): %s", line);
 			}
 			else if (2 == sscanf(line, "program %s %s", s1, s2)) {
 				for (p = s1; *p != '\0'; p++)
@@ -1398,9 +3451,10 @@ int main(int argn, char *argv[]) {
 				numprograms++;
 			}
 			else if (line[0] != '\n' && line[0] != '#')
-				printf("ERROR in irwmrc: %s", line);
+				logprintf("ERROR in irwmrc: %s", line);
 			if (numprograms >= MAXPROGRAMS) {
-				printf("ERROR in irwmrc: too many programs\n");
+				logprintf(
+					"ERROR in irwmrc: too many programs\n");
 				numprograms--;
 			}
 		}
@@ -1409,11 +3463,33 @@ int main(int argn, char *argv[]) {
 	programs[numprograms].title = NULL;
 	shortcuts[numprograms] = XK_VoidSymbol;
 
-				/* log file */
+				/* trace file */
 
-	if (! strcmp(logfile, "-"))
-		lf = -1;
-	else {
+	if (tracefile != NULL) {
+		tracefd = open(tracefile, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+			S_IRUSR | S_IWUSR);
+		if (tracefd == -1)
+			perror(tracefile);
+		else {
+			fprintf(stderr, "tracing to %s\n", tracefile);
+			memset(&sa, 0, sizeof(sa));
+			sa.sa_handler = tracecrash;
+			sa.sa_flags = SA_RESETHAND;
+			sigaction(SIGSEGV, &sa, NULL);
+			sigaction(SIGBUS, &sa, NULL);
+			sigaction(SIGFPE, &sa, NULL);
+			sigaction(SIGABRT, &sa, NULL);
+		}
+	}
+
+				/* log file, none if only tracing */
+
+	lf = -1;
+	if (logfile == NULL && tracefd != -1)
+		logstream = NULL;
+	else if (logfile == NULL || strcmp(logfile, "-")) {
+		if (logfile == NULL)
+			logfile = "irwm.log";
 		lf = creat(logfile, S_IRUSR | S_IWUSR);
 		if (lf == -1)
 			perror(logfile);
@@ -1421,6 +3497,8 @@ int main(int argn, char *argv[]) {
 			fprintf(stderr, "logging to %s\n", logfile);
 			dup2(lf, STDOUT_FILENO);
 			dup2(lf, STDERR_FILENO);
+			if (asynclog)
+				logstart(lf);
 		}
 	}
 
@@ -1430,7 +3508,7 @@ int main(int argn, char *argv[]) {
 		displayname = getenv("DISPLAY");
 	dsp = XOpenDisplay(displayname);
 	if (dsp == NULL) {
-		printf("cannot open display: %s\n", displayname);
+		logprintf("cannot open display: %s\n", displayname);
 		exit(EXIT_FAILURE);
 	}
 	defaulthandler = XSetErrorHandler(handler);
@@ -1439,7 +3517,7 @@ int main(int argn, char *argv[]) {
 
 	root = DefaultRootWindow(dsp);
 	XGetWindowAttributes(dsp, root, &rwa);
-	printf("root: 0x%lx (%dx%d)\n", root, rwa.width, rwa.height);
+	logprintf("root: 0x%lx (%dx%d)\n", root, rwa.width, rwa.height);
 	if (irwa) {
 		rwa.width = irwa->width;
 		rwa.height = irwa->height;
@@ -1447,7 +3525,8 @@ int main(int argn, char *argv[]) {
 		rwa.y = irwa->y;
 		free(irwa);
 	}
-	printf("geometry: %dx%d+%d+%d\n", rwa.width, rwa.height, rwa.x, rwa.y);
+	logprintf("geometry: %dx%d+%d+%d\n",
+		rwa.width, rwa.height, rwa.x, rwa.y);
 
 	XSelectInput(dsp, root,
 		SubstructureRedirectMask |
@@ -1469,7 +3548,7 @@ int main(int argn, char *argv[]) {
 	gc = XCreateGC(dsp, root, GCLineWidth, &gcv);
 	font = XftFontOpenName(dsp, 0, fontname == NULL ? XFTFONT : fontname);
 	if (font == NULL) {
-		printf("cannot load font %s",
+		logprintf("cannot load font %s",
 			fontname == NULL ? XFTFONT : fontname);
 		exit(EXIT_FAILURE);
 	}
@@ -1483,7 +3562,7 @@ int main(int argn, char *argv[]) {
 
 	panelroof = XCreateSimpleWindow(dsp, root, 0, 0, 1, 1, 0,
 		BlackPixel(dsp, 0), WhitePixel(dsp, 0));
-	printf("panel roof: 0x%lx\n", panelroof);
+	logprintf("panel roof: 0x%lx\n", panelroof);
 	XStoreName(dsp, panelroof, "irwm panel roof");
 
 				/* panel list window */
@@ -1492,13 +3571,14 @@ int main(int argn, char *argv[]) {
 		rwa.width / 2, rwa.height / 2 - listheight / 2,
 		listwidth, listheight,
 		2, BlackPixel(dsp, 0), WhitePixel(dsp, 0));
-	printf("panel list window: 0x%lx\n", panelwindow.window);
+	logprintf("panel list window: 0x%lx\n", panelwindow.window);
 	XStoreName(dsp, panelwindow.window, "irwm panel window");
 	XSelectInput(dsp, panelwindow.window, ExposureMask);
 
 	panelwindow.gc = gc;
 	panelwindow.font = font;
 	panelwindow.width = listwidth;
+	panelwindow.mapped = False;
 #ifdef XFT
 	panelwindow.draw = XftDrawCreate(dsp, panelwindow.window,
 		rwa.visual, rwa.colormap);
@@ -1512,13 +3592,14 @@ int main(int argn, char *argv[]) {
 		rwa.width / 3, rwa.height / 2 - listheight / 2,
 		listwidth, listheight,
 		2, BlackPixel(dsp, 0), WhitePixel(dsp, 0));
-	printf("confirm window: 0x%lx\n", confirmwindow.window);
+	logprintf("confirm window: 0x%lx\n", confirmwindow.window);
 	XStoreName(dsp, confirmwindow.window, "irwm confirm window");
 	XSelectInput(dsp, confirmwindow.window, ExposureMask);
 
 	confirmwindow.gc = gc;
 	confirmwindow.font = font;
 	confirmwindow.width = listwidth;
+	confirmwindow.mapped = False;
 #ifdef XFT
 	confirmwindow.draw = XftDrawCreate(dsp, confirmwindow.window,
 		rwa.visual, rwa.colormap);
@@ -1531,13 +3612,14 @@ int main(int argn, char *argv[]) {
 		rwa.width / 4, rwa.height / 2 - listheight / 2,
 		listwidth, listheight,
 		2, BlackPixel(dsp, 0), WhitePixel(dsp, 0));
-	printf("program list window: 0x%lx\n", progswindow.window);
+	logprintf("program list window: 0x%lx\n", progswindow.window);
 	XStoreName(dsp, progswindow.window, "irwm progs window");
 	XSelectInput(dsp, progswindow.window, ExposureMask);
 
 	progswindow.gc = gc;
 	progswindow.font = font;
 	progswindow.width = listwidth;
+	progswindow.mapped = False;
 #ifdef XFT
 	progswindow.draw = XftDrawCreate(dsp, progswindow.window,
 		rwa.visual, rwa.colormap);
@@ -1558,6 +3640,8 @@ int main(int argn, char *argv[]) {
 	net_client_list = XInternAtom(dsp, "_NET_CLIENT_LIST", False);
 	net_client_list_stacking =
 		XInternAtom(dsp, "_NET_CLIENT_LIST_STACKING", False);
+	net_wm_name = XInternAtom(dsp, "_NET_WM_NAME", False);
+	utf8_string = XInternAtom(dsp, "UTF8_STRING", False);
 
 	supported[nsupported++] = net_wm_state;
 	supported[nsupported++] = net_wm_state_stays_on_top;
@@ -1569,19 +3653,14 @@ int main(int argn, char *argv[]) {
 
 	clientlistupdate(dsp, root);
 
-				/* lirc client */
+				/* lirc */
 
 	if (! uselirc) {
-		printf("no lirc client, pass -l to enable\n");
-		lircclient = -1;
-	}
-	else {
-		printf("forking the lirc client, ");
-		lircclient = fork();
-		if (lircclient == 0)
-			return lirc(root, irwm, lircrc);
-		printf("pid=%d\n", lircclient);
+		logprintf("no lirc, pass -l to enable\n");
+		lircfd = -1;
 	}
+	else
+		lircfd = lircopen(lircrc, &lircconfig);
 
 				/* move pointer (for small windows) */
 
@@ -1589,6 +3668,7 @@ int main(int argn, char *argv[]) {
 
 				/* grab keys */
 
+	keytablebuild(dsp, shortcuts);
 	grabkeys(dsp, root, grab);
 
 				/* cursors, used to notify logging */
@@ -1596,35 +3676,123 @@ int main(int argn, char *argv[]) {
 	cursornormal = XCreateFontCursor(dsp, XC_X_cursor);
 	cursorlog = XCreateFontCursor(dsp, XC_based_arrow_down);
 
+				/* input descriptors and timers */
+
+	logtimer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (logtimer == -1)
+		perror("timerfd_create");
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd == -1) {
+		perror("epoll_create1");
+		exit(EXIT_FAILURE);
+	}
+	epolladd(epfd, ConnectionNumber(dsp));
+	epolladd(epfd, sigfd);
+	epolladd(epfd, logtimer);
+	epolladd(epfd, lircfd);
+
 				/* main loop */
 
 	retire = False;
 	restart = False;
+	pending = 0;
+	nready = 0;
+	batchlen = 0;
+	batchnext = 0;
 	for (run = True; run; ) {
 
-				/* X event */
+				/* X event, or wait for input */
 
-		XNextEvent(dsp, &evt);
-		printf("[%ld] ", evt.type == Error ? None : evt.xany.serial);
+		if (batchnext < batchlen) {
+			evt = batch[batchnext];
+			received = batchtime[batchnext];
+			batchnext++;
+			logprintf("[%ld] ",
+				evt.type == Error ? None : evt.xany.serial);
+		}
+		else if (pending > 0) {
+			for (batchlen = 0;
+			     batchlen < MAXBATCH && pending > 0;
+			     batchlen++, pending--) {
+				XNextEvent(dsp, &batch[batchlen]);
+				clock_gettime(CLOCK_MONOTONIC,
+					&batchtime[batchlen]);
+				traceevent(&batch[batchlen]);
+				stacknotify(&batch[batchlen], root);
+			}
+			batchlen = batchcoalesce(batch, batchtime, batchlen);
+			batchnext = 0;
+			continue;
+		}
+		else if (queuelen > 0) {
+			evt.type = NoEvent;
+			nready = 0;
+		}
+		else {
+			evt.type = NoEvent;
+			pending = XPending(dsp);
+			nready = epoll_wait(epfd, ready, MAXREADY,
+				pending > 0 ? 0 : -1);
+			if (nready == -1)
+				nready = 0;
+		}
 
 		command = NOCOMMAND;
+		requests = NextRequest(dsp);
+		sync = roundtrips;
 
 		switch(evt.type) {
 
+				/* other input: lirc, signals and timers */
+
+		case NoEvent:
+			for (i = 0; i < nready; i++) {
+				if (ready[i].data.fd == sigfd) {
+					while (read(sigfd, &si, sizeof(si)) ==
+					       sizeof(si)) {
+						reaper(si.ssi_signo);
+						if (si.ssi_signo == SIGUSR1)
+							tracedump();
+					}
+				}
+				else if (ready[i].data.fd == logtimer) {
+					timerclear(logtimer);
+					XDefineCursor(dsp, logwin,
+						cursornormal);
+					logwin = None;
+				}
+				else if (ready[i].data.fd == lircfd) {
+					if (lircinput(lircconfig) != -1)
+						continue;
+					logprintf("lirc connection closed\n");
+					epoll_ctl(epfd, EPOLL_CTL_DEL,
+						lircfd, NULL);
+					lircclose(lircconfig);
+					lircfd = -1;
+				}
+			}
+			command = commandpop(&received);
+			break;
+
 				/* substructure redirect events */
 
 		case MapRequest:
-			printf("MapRequest\n");
+			logprintf("MapRequest\n");
 			ermap = evt.xmaprequest;
-			tran = XGetTransientForHint(dsp, ermap.window, &win);
-			printf("\t0x%lx", ermap.window);
-			printf(" parent=0x%lx", ermap.parent);
-			if (tran)
-				printf(" transient_for=0x%lx", win);
-			printf("\n");
+			tombremove(ermap.window);
+			windowinfo(dsp, ermap.window, &info);
+			logprintf("\t0x%lx", ermap.window);
+			logprintf(" parent=0x%lx", ermap.parent);
+			if (info.transient)
+				logprintf(" transient_for=0x%lx",
+					info.transientfor);
+			logprintf("\n");
+			windowinfoprint(&info);
 
 			pn = paneladd(dsp, root, ermap.window, &rwa,
-				tran ? win : ermap.window);
+				info.transient ? info.transientfor :
+					ermap.window,
+				info.name);
 			if (pn == -1)
 				break;
 
@@ -1632,15 +3800,15 @@ int main(int argn, char *argv[]) {
 			XMapWindow(dsp, ermap.window); // -> MapNotify
 			break;
 		case ConfigureRequest:
-			printf("ConfigureRequest\n");
+			logprintf("ConfigureRequest\n");
 			erconfigure = evt.xconfigurerequest;
-			printf("\t0x%lx ", erconfigure.window);
-			printf("x=%d y=%d ", erconfigure.x, erconfigure.y);
-			printf("width=%d ", erconfigure.width);
-			printf("height=%d ", erconfigure.height);
-			printf("border_width=%d ", erconfigure.border_width);
-			printf("above=0x%lx ", erconfigure.above);
-			printf("\n");
+			logprintf("\t0x%lx ", erconfigure.window);
+			logprintf("x=%d y=%d ", erconfigure.x, erconfigure.y);
+			logprintf("width=%d ", erconfigure.width);
+			logprintf("height=%d ", erconfigure.height);
+			logprintf("border_width=%d ", erconfigure.border_width);
+			logprintf("above=0x%lx ", erconfigure.above);
+			logprintf("\n");
 
 			pn = panelfind(erconfigure.window, PANEL | CONTENT);
 			if (pn != -1) {
@@ -1648,7 +3816,7 @@ int main(int argn, char *argv[]) {
 				break;
 			}
 
-			printf("CONFIGURE 0x%lx\n", erconfigure.window);
+			logprintf("CONFIGURE 0x%lx\n", erconfigure.window);
 			wc.x = erconfigure.x;
 			wc.y = erconfigure.y;
 			wc.width = erconfigure.width;
@@ -1660,171 +3828,176 @@ int main(int argn, char *argv[]) {
 				erconfigure.value_mask & ~ CWStackMode, &wc);
 			break;
 		case CirculateRequest:
-			printf("CirculateRequest\n");
+			logprintf("CirculateRequest\n");
 			break;
 
 					/* substructure notify events */
 
 		case CirculateNotify:
-			printf("CirculateNotify\n");
+			logprintf("CirculateNotify\n");
 			break;
 		case ConfigureNotify:
-			printf("ConfigureNotify\n");
+			logprintf("ConfigureNotify\n");
 			econfigure = evt.xconfigure;
-			printf("\t0x%lx ", econfigure.window);
-			printf("x=%d y=%d ", econfigure.x, econfigure.y);
-			printf("width=%d ", econfigure.width);
-			printf("height=%d ", econfigure.height);
-			printf("border_width=%d ", econfigure.border_width);
-			printf("above=0x%lx ", econfigure.above);
-			printf("\n");
+			logprintf("\t0x%lx ", econfigure.window);
+			logprintf("x=%d y=%d ", econfigure.x, econfigure.y);
+			logprintf("width=%d ", econfigure.width);
+			logprintf("height=%d ", econfigure.height);
+			logprintf("border_width=%d ", econfigure.border_width);
+			logprintf("above=0x%lx ", econfigure.above);
+			logprintf("\n");
+			overridegeometry(&econfigure);
 			if (overridefix)
 				overrideplace(dsp, econfigure.window, &rwa);
 			break;
 		case CreateNotify:
-			printf("CreateNotify\n");
-			printf("\t0x%lx ", evt.xcreatewindow.window);
-			printf("parent=0x%lx", evt.xcreatewindow.parent);
+			logprintf("CreateNotify\n");
+			logprintf("\t0x%lx ", evt.xcreatewindow.window);
+			logprintf("parent=0x%lx", evt.xcreatewindow.parent);
+			tombremove(evt.xcreatewindow.window);
 			if (evt.xcreatewindow.override_redirect) {
-				printf(" override_redirect\n");
-				overrideadd(evt.xcreatewindow.window);
+				logprintf(" override_redirect\n");
+				overrideadd(&evt.xcreatewindow);
 			}
 			else
-				printf("\n");
+				logprintf("\n");
 			break;
 		case DestroyNotify:
-			printf("DestroyNotify\n");
+			logprintf("DestroyNotify\n");
 			edestroy = evt.xdestroywindow;
-			printf("\t0x%lx ", edestroy.window);
-			printf("parent=0x%lx", edestroy.event);
-			printf("\n");
+			logprintf("\t0x%lx ", edestroy.window);
+			logprintf("parent=0x%lx", edestroy.event);
+			logprintf("\n");
 
+			tombadd(edestroy.window);
 			overrideremove(edestroy.window);
 
 			pn = panelfind(edestroy.event, PANEL);
 			if (pn == -1)
 				break;
 
+			i = activepanel;
 			panelremove(dsp, pn, True);
-			panelenter(dsp, root, -1, activepanel);
-			raiselists(dsp,
-				&panelwindow, &confirmwindow, &progswindow);
+			if (activepanel != i)
+				batchrefocus = True;
 
 			if (numactive > 0 || numpanels > 0)
 				break;
 
 			if (quitonlastclose) {
-				printf("QUIT on last close\n");
+				logprintf("QUIT on last close\n");
 				run = False;
 				break;
 			}
 			else
-				printf("QUIT on last close disabled\n");
+				logprintf("QUIT on last close disabled\n");
 
 			break;
 		case GravityNotify:
-			printf("GravityNotify\n");
+			logprintf("GravityNotify\n");
 			break;
 		case ReparentNotify:
-			printf("ReparentNotify\n");
+			logprintf("ReparentNotify\n");
 			ereparent = evt.xreparent;
-			printf("\t0x%lx reparented ", ereparent.window);
+			logprintf("\t0x%lx reparented ", ereparent.window);
 			if (ereparent.event != ereparent.parent)
-				printf("away from 0x%lx, ", ereparent.event);
-			printf("to 0x%lx\n", ereparent.parent);
+				logprintf("away from 0x%lx, ", ereparent.event);
+			logprintf("to 0x%lx\n", ereparent.parent);
 			if (ereparent.event == ereparent.parent)
 				break;
 			pn = panelfind(ereparent.event, PANEL);
 			if (pn == -1)
 				break;
-			printf("\tpanel %d becomes empty, removing\n", pn);
+			logprintf("\tpanel %d becomes empty, removing\n", pn);
 			panelremove(dsp, pn, True);
 			break;
 		case MapNotify:
-			printf("MapNotify\n");
-			printf("\t0x%lx", evt.xmap.window);
-			printf(" parent=0x%lx", evt.xmap.event);
-			printf("\n");
+			logprintf("MapNotify\n");
+			logprintf("\t0x%lx", evt.xmap.window);
+			logprintf(" parent=0x%lx", evt.xmap.event);
+			logprintf("\n");
 
 			pn = panelfind(evt.xmap.window, CONTENT);
 			if (pn == -1 && overridefix)
 				overrideplace(dsp, evt.xunmap.window, &rwa);
-			if (pn == -1 || pn == activepanel)
+			if (pn == -1)
 				break;
-			panelenter(dsp, root, activepanel, pn);
-			raiselists(dsp,
-				&panelwindow, &confirmwindow, &progswindow);
+			if (panel[pn].warm) {
+				logprintf("\twarm panel %d\n", pn);
+				break;		/* mapped by panelwarm */
+			}
+			batchswitch(pn);
 
 			break;
 		case UnmapNotify:
-			printf("UnmapNotify\n");
-			printf("\t0x%lx", evt.xunmap.window);
-			printf(" parent=0x%lx", evt.xunmap.event);
-			printf(" %s", evt.xunmap.send_event ? "synthetic" : "");
-			printf("\n");
+			logprintf("UnmapNotify\n");
+			logprintf("\t0x%lx", evt.xunmap.window);
+			logprintf(" parent=0x%lx", evt.xunmap.event);
+			logprintf(" %s",
+				evt.xunmap.send_event ? "synthetic" : "");
+			logprintf("\n");
 
 			pn = panelfind(evt.xunmap.window, CONTENT);
 			if (pn == -1)
 				break;
-			printf("\tcontent in panel %d\n", pn);
+			logprintf("\tcontent in panel %d\n", pn);
 
 			if (evt.xunmap.send_event) {
+				i = activepanel;
 				panelremove(dsp, pn, False);
-				panelenter(dsp, root, -1, activepanel);
-				raiselists(dsp, &panelwindow,
-					&confirmwindow, &progswindow);
+				if (activepanel != i)
+					batchrefocus = True;
 
 				if (numactive == 0 && numpanels == 0) {
-					printf("QUIT on last close");
+					logprintf("QUIT on last close");
 					if (quitonlastclose) {
-						printf("\n");
+						logprintf("\n");
 						run = False;
 						break;
 					}
 					else
-						printf(" disabled\n");
+						logprintf(" disabled\n");
 				}
 			}
 
 			win = panel[pn].leader;
 			if (win == evt.xunmap.window)
 				break;
-			printf("\tleader is 0x%lx\n", win);
+			logprintf("\tleader is 0x%lx\n", win);
 
 			pn = panelfind(win, CONTENT);
-			if (pn == -1 || pn == activepanel)
+			if (pn == -1)
 				break;
 
-			printf("\tswitching to panel %d\n", pn);
-			panelenter(dsp, root, activepanel, pn);
-			raiselists(dsp,
-				&panelwindow, &confirmwindow, &progswindow);
+			logprintf("\tswitching to panel %d\n", pn);
+			batchswitch(pn);
 
 			break;
 		case ClientMessage:
-			printf("ClientMessage\n");
+			logprintf("ClientMessage\n");
 			emessage = evt.xclient;
-			printf("\t0x%lx",  emessage.window);
-			message = XGetAtomName(dsp, emessage.message_type);
-			printf(" %-20s ", message);
+			logprintf("\t0x%lx",  emessage.window);
+			message = ROUNDTRIP(XGetAtomName(dsp,
+				emessage.message_type));
+			logprintf(" %-20s ", message);
 			XFree(message);
-			printf("%d\n", emessage.format);
-			printf("\t\tdata: ");
+			logprintf("%d\n", emessage.format);
+			logprintf("\t\tdata: ");
 			switch (emessage.format) {
 			case 8:
 				for (i = 0; i < 20; i++)
-					printf(" %d", emessage.data.b[i]);
+					logprintf(" %d", emessage.data.b[i]);
 				break;
 			case 16:
 				for (i = 0; i < 10; i++)
-					printf(" %d", emessage.data.s[i]);
+					logprintf(" %d", emessage.data.s[i]);
 				break;
 			case 32:
 				for (i = 0; i < 5; i++)
-					printf(" %ld", emessage.data.l[i]);
+					logprintf(" %ld", emessage.data.l[i]);
 				break;
 			}
-			printf("\n");
+			logprintf("\n");
 
 			if (emessage.message_type == irwm &&
 			    emessage.format == 32)
@@ -1835,32 +4008,32 @@ int main(int argn, char *argv[]) {
 				activewindow = emessage.window;
 				if (activewindow == None)
 					break;
-				printf("ACTIVEWINDOW 0x%lx\n", activewindow);
+				logprintf("ACTIVEWINDOW 0x%lx\n", activewindow);
 				pn = panelfind(activewindow, CONTENT);
 				if (pn != -1)
-					panelenter(dsp, root, activepanel, pn);
+					batchswitch(pn);
 				else {
 					XMapWindow(dsp, activewindow);
 					XSetInputFocus(dsp, activewindow,
 						RevertToParent, CurrentTime);
 					clientlistupdate(dsp, root);
-					overrideraise(dsp);
+					stackapply(dsp, activepanel);
 				}
-				raiselists(dsp, &panelwindow, &confirmwindow,
-					&progswindow);
+				batchraise = True;
 			}
 
 			if (emessage.message_type == net_wm_state &&
 			    emessage.format == 32) {
 				c = emessage.data.l[0];
-				printf("\t\t%s", c == 0 ? "REMOVE" :
+				logprintf("\t\t%s", c == 0 ? "REMOVE" :
 					c == 1 ? "ADD" : "TOGGLE");
 				for (i = 1; i <= 2; i++)  {
 					j = emessage.data.l[i];
 					if (j == 0)
 						continue;
-					message = XGetAtomName(dsp, j);
-					printf(" %s", message);
+					message = ROUNDTRIP(XGetAtomName(dsp,
+						j));
+					logprintf(" %s", message);
 					XFree(message);
 
 					w = overrideexists(emessage.window);
@@ -1868,12 +4041,12 @@ int main(int argn, char *argv[]) {
 						continue;
 					if ((Atom) j != net_wm_state_stays_on_top)
 						continue;
-					override[w].ontop =
+					overrideontop(w,
 						c == 0 ? False :
 						c == 1 ? True :
-						         ! override[w].ontop;
+						         ! override[w].ontop);
 				}
-				printf("\n");
+				logprintf("\n");
 			}
 
 			break;
@@ -1881,27 +4054,49 @@ int main(int argn, char *argv[]) {
 					/* keypress events */
 
 		case KeyPress:
-			printf("KeyPress\n");
+			logprintf("KeyPress\n");
 			ekey = evt.xkey;
-			printf("\t0x%lx ", ekey.subwindow);
-			printf("key=%d state=%d", ekey.keycode, ekey.state);
-			printf("\n");
+			logprintf("\t0x%lx ", ekey.subwindow);
+			logprintf("key=%d state=%d", ekey.keycode, ekey.state);
+			logprintf("\n");
 
-			command = eventtocommand(dsp, ekey,
-					showprogs ? shortcuts : NULL);
+			command = eventtocommand(ekey, showprogs);
 			break;
 		case KeyRelease:
-			printf("KeyRelease\n");
+			logprintf("KeyRelease\n");
 			ekey = evt.xkey;
-			printf("\t0x%lx ", ekey.subwindow);
-			printf("key=%d state=%d", ekey.keycode, ekey.state);
-			printf("\n");
+			logprintf("\t0x%lx ", ekey.subwindow);
+			logprintf("key=%d state=%d", ekey.keycode, ekey.state);
+			logprintf("\n");
 			break;
 
 					/* other events */
 
+		case PropertyNotify:
+			logprintf("PropertyNotify\n");
+			logprintf("\t0x%lx", evt.xproperty.window);
+			logprintf(" atom=%ld", evt.xproperty.atom);
+			logprintf("\n");
+			if (evt.xproperty.atom != XA_WM_NAME &&
+			    evt.xproperty.atom != net_wm_name &&
+			    evt.xproperty.atom != wm_protocols)
+				break;
+			pn = panelfind(evt.xproperty.window, CONTENT);
+			if (pn == -1 || tombstoned(evt.xproperty.window))
+				break;
+			if (evt.xproperty.atom == wm_protocols) {
+				panel[pn].deletewindow = -1;
+				break;
+			}
+			panelname(dsp, pn, NULL);
+			panelprint("NAME", pn);
+			if (showpanel)
+				XClearArea(dsp, panelwindow.window,
+					0, 0, 0, 0, True);
+			break;
+
 		case Expose:
-			printf("Expose\n");
+			logprintf("Expose\n");
 			if (evt.xexpose.window == panelwindow.window)
 				drawpanel(dsp, &panelwindow, activepanel);
 			if (evt.xexpose.window == progswindow.window)
@@ -1912,15 +4107,24 @@ int main(int argn, char *argv[]) {
 			break;
 
 		case MappingNotify:
-			printf("MappingNotify\n");
-			printf("\t%d", evt.xmapping.request);
-			printf(" %d", evt.xmapping.first_keycode);
-			printf(" %d", evt.xmapping.count);
-			printf("\n");
+			logprintf("MappingNotify\n");
+			logprintf("\t%d", evt.xmapping.request);
+			logprintf(" %d", evt.xmapping.first_keycode);
+			logprintf(" %d", evt.xmapping.count);
+			logprintf("\n");
+			if (evt.xmapping.request == MappingPointer)
+				break;
+
+			XRefreshKeyboardMapping(&evt.xmapping);
+			XUngrabKey(dsp, AnyKey, AnyModifier, root);
+			keytablebuild(dsp, shortcuts);
+			grabkeys(dsp, root, True);
+			if (! grab)
+				grabkeys(dsp, root, False);
 			break;
 
 		case Error:
-			printf("Error\n");
+			logprintf("Error\n");
 			err = evt.xerror;
 			win = None;
 
@@ -1930,59 +4134,67 @@ int main(int argn, char *argv[]) {
 			     err.request_code == X_ChangeProperty ||
 			     err.request_code == X_SetInputFocus ||
 			     err.request_code == X_ConfigureWindow ||
+			     err.request_code == X_ChangeWindowAttributes ||
 			     err.request_code == X_GetWindowAttributes ||
 			     err.request_code == X_GetProperty ||
 			     err.request_code == X_ReparentWindow ||
 			     err.request_code == X_DeleteProperty ||
 			     err.request_code == X_DestroyWindow)) {
-				printf("NOTE: ignoring a BadWindow error ");
-				printf("window=0x%lx ", err.resourceid);
+				logprintf("NOTE: ignoring a BadWindow error ");
+				logprintf("window=0x%lx ", err.resourceid);
 				sprintf(numstring, "%d", err.request_code);
 				XGetErrorDatabaseText(dsp, "XRequest",
 					numstring, "", errortext, 2000);
-				printf("%s\n", errortext);
+				logprintf("%s\n", errortext);
 
 				win = err.resourceid;
 			}
 			if (err.error_code == BadValue &&
 			    err.request_code == X_KillClient) {
-				printf("NOTE: ignoring a BadValue error ");
-				printf("on a X_KillClient request\n");
+				logprintf("NOTE: ignoring a BadValue error ");
+				logprintf("on a X_KillClient request\n");
 
 				win = err.resourceid;
 			}
 			if (err.error_code == BadAtom &&
 			    err.request_code == X_GetAtomName) {
-				printf("NOTE: ignoring a BadAtom error ");
-				printf("on a X_GetAtomName request\n");
+				logprintf("NOTE: ignoring a BadAtom error ");
+				logprintf("on a X_GetAtomName request\n");
 				break;
 			}
-			fflush(stdout);
+			logflush();
 
 			if (win == None)
 				defaulthandler(dsp, &err);
+			else if (tombstoned(win))
+				logprintf("\twindow 0x%lx already destroyed\n",
+					win);
 			else {
-				pn = panelfind(win, CONTENT);
-				if (pn == -1)
-					break;
-				panelremove(dsp, pn, True);
-				panelenter(dsp, root, -1, activepanel);
-				raiselists(dsp, &panelwindow,
-					&confirmwindow, &progswindow);
+				tombadd(win);
+				if (panelfind(win, CONTENT) != -1)
+					batchreap = True;
 			}
 			break;
 		default:
-			printf("Unexpected event, type=%d\n", evt.type);
+			logprintf("Unexpected event, type=%d\n", evt.type);
 		}
-		fflush(stdout);
+		logflush();
+		if (evt.type >= 0 && evt.type < LASTEvent)
+			histoadd(&eventstats[evt.type], elapsed(&received));
 
 					/* execute command */
 
+		if (command != NOCOMMAND)
+			batchflush(dsp, root,
+				&panelwindow, &confirmwindow, &progswindow);
 		while (command != NOCOMMAND) {
 
 						/* print command */
 
-			printf("COMMAND %s\n", commandtostring(command));
+			logprintf("COMMAND %s\n", commandtostring(command));
+			traceadd(TRACECOMMAND, 0, activecontent, None,
+				command, 0);
+			issued = command;	/* accounted as received */
 
 			if (command == PANELWINDOW && showpanel)
 				command = singlekey ? PROGSWINDOW : HIDEWINDOW;
@@ -1996,22 +4208,21 @@ int main(int argn, char *argv[]) {
 						/* commands in lists */
 
 			if (NUMWINDOW(1) <= command) {
-				if (showpanel) {
-					if (activepanel == -1)
-						continue;
-					j = 0;
-					for (i = 0; i < activepanel; i++)
-						if (! panel[i].withdrawn)
-							j++;
-					panelswitch(dsp, root,
-						command - NUMWINDOW(1) - j);
+				if (showpanel && activepanel != -1) {
+					pn = panelnth(command - NUMWINDOW(1));
+					if (pn != -1)
+						panelenter(dsp, root,
+							activepanel, pn);
 					XClearArea(dsp, panelwindow.window,
 						0, 0, 0, 0, True);
-					XRaiseWindow(dsp, panelwindow.window);
+					stacklists(dsp,
+						&panelwindow,
+						&confirmwindow,
+						&progswindow);
 				}
 				if (showprogs) {
 					progselected = command - NUMWINDOW(1);
-					printf("PROGSELECTED %d \"%s\"\n",
+					logprintf("PROGSELECTED %d \"%s\"\n",
 						progselected,
 						programs[progselected].title);
 				}
@@ -2025,8 +4236,14 @@ int main(int argn, char *argv[]) {
 				break;
 			case NEXTPANEL:
 			case PREVPANEL:
-				panelswitch(dsp, root,
-					command == PREVPANEL ? -1 : 1);
+				rel = command == PREVPANEL ? -1 : 1;
+				rel += commandmerge(NEXTPANEL, PREVPANEL);
+				rel += batchmerge(batch, &batchnext, batchlen,
+					irwm, showprogs, NEXTPANEL, PREVPANEL);
+				if (rel != 1 && rel != -1)
+					logprintf("SWITCH %d\n", rel);
+				if (rel != 0)
+					panelswitch(dsp, root, rel);
 				raiselists(dsp,
 					&panelwindow,
 					&confirmwindow,
@@ -2044,10 +4261,6 @@ int main(int argn, char *argv[]) {
 				}
 				showconfirm = True;
 				confirmselected = 0;
-				XMapWindow(dsp, confirmwindow.window);
-				XGrabKeyboard(dsp, root, False,
-					GrabModeAsync, GrabModeAsync,
-					CurrentTime);
 				break;
 
 			case PANELWINDOW:
@@ -2068,21 +4281,46 @@ int main(int argn, char *argv[]) {
 
 			case UPWINDOW:
 			case DOWNWINDOW:
-				i = command == UPWINDOW ? -1 : 1;
-				if (showpanel) {
-					panelswitch(dsp, root, i);
+			case PAGEUPWINDOW:
+			case PAGEDOWNWINDOW:
+				page = command == PAGEUPWINDOW ||
+				       command == PAGEDOWNWINDOW;
+				if (page)
+					i = command == PAGEUPWINDOW ?
+						-LISTROWS : LISTROWS;
+				else {
+					i = command == UPWINDOW ? -1 : 1;
+					i += commandmerge(DOWNWINDOW, UPWINDOW);
+					i += batchmerge(batch, &batchnext,
+						batchlen, irwm, showprogs,
+						DOWNWINDOW, UPWINDOW);
+					i *= repeatstep(command, &received);
+				}
+				if (i != 1 && i != -1)
+					logprintf("MOVE %d\n", i);
+				if (showpanel && activepanel != -1) {
+					pn = panelnth(listmove(
+						panelposition(activepanel),
+						numactive, i, page));
+					if (pn != -1 && pn != activepanel)
+						panelenter(dsp, root,
+							activepanel, pn);
 					XClearArea(dsp, panelwindow.window,
 						0, 0, 0, 0, True);
-					XRaiseWindow(dsp, panelwindow.window);
+					stacklists(dsp,
+						&panelwindow,
+						&confirmwindow,
+						&progswindow);
 				}
 				if (showprogs) {
-					MODULEINCREASE(progselected,
-						numprograms, i);
+					progselected = listmove(progselected,
+						numprograms, i, page);
 					XClearArea(dsp, progswindow.window,
 						0, 0, 0, 0, True);
 				}
 				if (showconfirm) {
-					MODULEINCREASE(confirmselected, 2, i);
+					confirmselected = listmove(
+						confirmselected, 2, i, page);
 					XClearArea(dsp, confirmwindow.window,
 						0, 0, 0, 0, True);
 				}
@@ -2091,49 +4329,30 @@ int main(int argn, char *argv[]) {
 			case OKWINDOW:
 				if (showpanel) {
 					showpanel = False;
-					XUnmapWindow(dsp, panelwindow.window);
-					XUngrabKeyboard(dsp, CurrentTime);
 				}
 				else if (showprogs) {
 					showprogs = False;
-					XUnmapWindow(dsp, progswindow.window);
-					XUngrabKeyboard(dsp, CurrentTime);
 					if (command == HIDEWINDOW)
 						break;
 					p = programs[progselected].program;
 					t = programs[progselected].title;
 					if (p)
 						forkprogram(p, NULL);
-					else if (! strcmp(t, "resize")) {
-						command = RESIZE;
-						continue;
-					}
-					else if (! strcmp(t, "loglist")) {
-						command = LOGLIST;
-						continue;
-					}
-					else if (! strcmp(t, "positionfix")) {
-						command = POSITIONFIX;
-						continue;
-					}
-					else if (! strcmp(t, "restart")) {
-						command = RESTART;
-						continue;
-					}
-					else if (! strcmp(t, "retire")) {
-						command = RETIRE;
-						continue;
-					}
-					else if (! strcmp(t, "quit")) {
-						command = QUIT;
-						continue;
-					}
+					else if (! strcmp(t, "resize"))
+						redirect = RESIZE;
+					else if (! strcmp(t, "loglist"))
+						redirect = LOGLIST;
+					else if (! strcmp(t, "positionfix"))
+						redirect = POSITIONFIX;
+					else if (! strcmp(t, "restart"))
+						redirect = RESTART;
+					else if (! strcmp(t, "retire"))
+						redirect = RETIRE;
+					else if (! strcmp(t, "quit"))
+						redirect = QUIT;
 				}
 				else if (showconfirm) {
 					showconfirm = False;
-					XUngrabKeyboard(dsp, CurrentTime);
-					XUnmapWindow(dsp,
-						confirmwindow.window);
 					if (command == HIDEWINDOW)
 						break;
 					if (confirmselected == 0) {
@@ -2145,22 +4364,19 @@ int main(int argn, char *argv[]) {
 				break;
 			case KOWINDOW:
 				if (showpanel && activepanel != -1)
-					closewindow(dsp,
-						panel[activepanel].content);
+					closewindow(dsp, activepanel);
 				break;
 			case ENDWINDOW:
 				if (showpanel &&
 				    activepanel != -1 &&
-				    activepanel < numpanels - 1) {
-					for (i = activepanel;
-					     i < numpanels - 1;
-					     i++)
-						panelswap(i, i + 1);
-					previouspanel = activepanel;
-					activepanel = numpanels - 1;
+				    activepanel != lastpanel) {
+					panelmoveend(activepanel);
 					XClearArea(dsp, panelwindow.window,
 						0, 0, 0, 0, True);
-					XRaiseWindow(dsp, panelwindow.window);
+					stacklists(dsp,
+						&panelwindow,
+						&confirmwindow,
+						&progswindow);
 				}
 				break;
 
@@ -2175,73 +4391,140 @@ int main(int argn, char *argv[]) {
 				panelresize(dsp, rwa, activepanel);
 				break;
 			case LOGLIST:
-				win = activepanel == -1 ? root :
+				if (logwin != None)
+					XDefineCursor(dsp, logwin,
+						cursornormal);
+				logwin = activepanel == -1 ? root :
 					panel[activepanel].content;
-				XDefineCursor(dsp, win, cursorlog);
-				for (pn = 0; pn < numpanels; pn++)
+				XDefineCursor(dsp, logwin, cursorlog);
+				for (pn = firstpanel; pn != -1;
+				     pn = panel[pn].next)
 					panelprint("LOG", pn);
+				logprintf("MRU");
+				for (pn = firstmru; pn != -1;
+				     pn = panel[pn].mrunext)
+					logprintf(" %d", pn);
+				logprintf("\n");
 				for (i = 0; i < numoverride; i++)
 					overrideprint("LOG", i);
-				fflush(stdout);
-				XFlush(dsp);
-				usleep(300000);
-				XDefineCursor(dsp, win, cursornormal);
+				logflush();
+				tracedump();
+				timerset(logtimer, 300);
+				break;
+			case LASTPANEL:
+				if (firstmru == -1 ||
+				    panel[firstmru].mrunext == -1)
+					break;
+				panelenter(dsp, root, activepanel,
+					firstmru == activepanel ?
+						panel[firstmru].mrunext :
+						firstmru);
+				raiselists(dsp,
+					&panelwindow,
+					&confirmwindow,
+					&progswindow);
+				break;
+			case MRUWINDOW:
+				if (! showpanel)
+					break;
+				mruorder = ! mruorder;
+				logprintf("MRUORDER %d\n", mruorder);
+				XClearArea(dsp, panelwindow.window,
+					0, 0, 0, 0, True);
 				break;
 			case POSITIONFIX:
 				overridefix = ! overridefix;
-				printf("OVERRIDEFIX %d\n", overridefix);
+				logprintf("OVERRIDEFIX %d\n", overridefix);
+				break;
+			case STATS:
+				for (i = 0; i <= NUMWINDOW(0); i++)
+					if (i < NUMWINDOW(0))
+						histoprint("command",
+							commandtostring(i),
+							&commandstats[i]);
+					else
+						histoprint("command",
+							"NUMWINDOW(n)",
+							&commandstats[i]);
+				for (i = 0; i < LASTEvent; i++)
+					histoprint("event", eventname[i],
+						&eventstats[i]);
+				for (i = 0; i < LASTEvent; i++)
+					requestprint(eventname[i], i);
+				requestprint("other input", LASTEvent);
 				break;
 			}
 
 						/* show/remove lists */
 
-			if (showpanel)
-				XMapWindow(dsp, panelwindow.window);
-			else
-				XUnmapWindow(dsp, panelwindow.window);
-			if (showprogs)
-				XMapWindow(dsp, progswindow.window);
-			else
-				XUnmapWindow(dsp, progswindow.window);
-			if (showconfirm)
-				XMapWindow(dsp, confirmwindow.window);
-			else
-				XUnmapWindow(dsp, confirmwindow.window);
-			if (showpanel || showprogs || showconfirm)
-				XGrabKeyboard(dsp, root, False,
-					GrabModeAsync, GrabModeAsync,
-					CurrentTime);
-
-			fflush(stdout);
-			command = NOCOMMAND;
+			i = showlist(dsp, &panelwindow, showpanel);
+			i |= showlist(dsp, &progswindow, showprogs);
+			i |= showlist(dsp, &confirmwindow, showconfirm);
+			if (i)
+				stacklists(dsp,
+					&panelwindow,
+					&confirmwindow,
+					&progswindow);
+			grabkeyboard(dsp, root,
+				showpanel || showprogs || showconfirm);
+			if (mrufrozen && ! showpanel) {
+				mrufrozen = False;
+				mrupush(activepanel);
+			}
+			mrufrozen = showpanel;
+
+			XFlush(dsp);
+			commandstat(issued, &received);
+			if (evt.type == NoEvent)
+				lircclear();
+			logflush();
+			command = redirect;	/* from the program list */
+			redirect = NOCOMMAND;
+		}
+
+					/* end of batch */
+
+		if (batchlen > 0 && batchnext == batchlen) {
+			batchflush(dsp, root,
+				&panelwindow, &confirmwindow, &progswindow);
+			batchlen = 0;
+			batchnext = 0;
 		}
+
+					/* account requests and round trips */
+
+		requests = NextRequest(dsp) - requests;
+		sync = roundtrips - sync;
+		if (evt.type == NoEvent && requests == 0 && sync == 0)
+			continue;
+		requestadd(evt.type, requests, sync);
+		logprintf("\trequests=%lu roundtrips=%lu\n", requests, sync);
+		logflush();
 	}
 
 				/* close wm */
 
-	if (lircclient == -1)
-		printf("no lirc client to kill\n");
-	else {
-		printf("killing lirc client, pid=%d\n", lircclient);
-		kill(lircclient, SIGTERM);
-	}
-	for (i = 0; i < numpanels; i++)
+	if (lircfd != -1)
+		lircclose(lircconfig);
+	for (i = firstpanel; i != -1; i = panel[i].next)
 		if (restart || retire) {
 			XReparentWindow(dsp, panel[i].content, root, 0, 0);
 			if (unmaponleave && ! panel[i].withdrawn)
 				XMapWindow(dsp, panel[i].content);
 		}
 		else
-			closewindow(dsp, panel[i].content);
+			closewindow(dsp, i);
 	XSetInputFocus(dsp, root, RevertToNone, CurrentTime);
 	XCloseDisplay(dsp);
+	tracedump();
 	if (retire && numpanels == 0)
 		forkprogram("xterm", NULL);
 	if (restart) {
 		cargv[cargn - 1] = startprogs ? "-n" : NULL;
 		cargv[cargn] = NULL;
-		printf("irwm restart\n");
-		fflush(stdout);
+		logprintf("irwm restart\n");
+		logflush();
+		logstop();
 		if (lf != -1) {
 			close(lf);
 			close(STDOUT_FILENO);
@@ -2254,7 +4537,8 @@ int main(int argn, char *argv[]) {
 		while (1) {
 		}
 
-	printf("irwm ended\n");
+	logprintf("irwm ended\n");
+	logstop();
 	return EXIT_SUCCESS;
 }
 
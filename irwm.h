@@ -0,0 +1,148 @@
+/*
+ * irwm.h
+ *
+ * the commands, the trace records and the event names; shared by irwm and
+ * irwmtrace, so that the converted trace always matches the window manager
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <X11/X.h>
+#include <X11/keysym.h>
+
+/*
+ * commands
+ */
+#define NOCOMMAND      0	/* no command */
+#define NEXTPANEL      1	/* switch to next panel */
+#define PREVPANEL      2	/* switch to previous panel */
+#define RESTART        3	/* restart irwm */
+#define RETIRE         4	/* retire irwm */
+#define QUIT           5	/* quit irwm */
+#define LOGLIST        6	/* print panels in the log file */
+#define POSITIONFIX    7	/* toggle: fix position of override windows */
+#define RESIZE         8	/* resize the current panel */
+#define PASSKEYS       9	/* pass keystrokes to the window or stop it */
+
+#define PANELWINDOW   10	/* show the panel list window */
+#define PROGSWINDOW   11	/* show the programs window */
+#define CONFIRMWINDOW 12	/* show the quit confirm dialog */
+
+#define UPWINDOW      20	/* up in the window */
+#define DOWNWINDOW    21	/* down in the window */
+#define HIDEWINDOW    22	/* hide both windows */
+#define OKWINDOW      23	/* select the current item in the window */
+#define KOWINDOW      24	/* close currently selected panel */
+#define ENDWINDOW     25	/* move currently active panel at the end */
+#define PAGEUPWINDOW  26	/* a page up in the window */
+#define PAGEDOWNWINDOW 27	/* a page down in the window */
+#define MRUWINDOW     28	/* toggle panel list in recently used order */
+
+#define STATS         30	/* print latency statistics */
+#define LASTPANEL     31	/* switch to the last used panel */
+
+#define NUMWINDOW(n)  (100 + (n))	/* select entry n in the window */
+
+/*
+ * commands, their names and keystrokes
+ */
+struct {
+	int command;	char *string;	int keysym;	unsigned modifier;
+} commandstring[] = {
+	{NOCOMMAND,	"NOCOMMAND",	XK_VoidSymbol,	0},
+	{NEXTPANEL,	"NEXTPANEL",	XK_Right,	Mod1Mask},
+	{PREVPANEL,	"PREVPANEL",	XK_Left,	Mod1Mask},
+	{LASTPANEL,	"LASTPANEL",	XK_Down,	ControlMask | Mod1Mask},
+	{RESTART,	"RESTART", XK_Tab, ControlMask | ShiftMask | Mod1Mask},
+	{QUIT,		"QUIT",		XK_Tab,	ControlMask | ShiftMask},
+	{LOGLIST,	"LOGLIST",	XK_l,	ControlMask | ShiftMask},
+	{STATS,		"STATS", XK_s, ControlMask | ShiftMask | Mod1Mask},
+	{PANELWINDOW,	"PANELWINDOW",	XK_Tab,		Mod1Mask},
+	{PROGSWINDOW,	"PROGSWINDOW",	XK_Tab,		ControlMask},
+	{PASSKEYS,	"PASSKEYS",	XK_Up,		Mod1Mask},
+	{-1,		"ENDGRAB",	XK_VoidSymbol,	0},
+	{RETIRE,	"RETIRE", 	XK_VoidSymbol,  0},
+	{RESIZE,	"RESIZE",	XK_VoidSymbol,  0},
+	{POSITIONFIX,	"POSITIONFIX",	XK_VoidSymbol,	0},
+	{CONFIRMWINDOW, "CONFIRMWINDOW", XK_VoidSymbol, 0},
+	{UPWINDOW,	"UPWINDOW",	XK_Up,		0},
+	{DOWNWINDOW,	"DOWNWINDOW",	XK_Down,	0},
+	{HIDEWINDOW,	"HIDEWINDOW",	XK_Escape,	0},
+	{OKWINDOW,	"OKWINDOW",	XK_Return,	0},
+	{KOWINDOW,	"KOWINDOW",	XK_c,		0},
+	{ENDWINDOW,	"ENDWINDOW",	XK_e,		0},
+	{PAGEUPWINDOW,	"PAGEUPWINDOW",	XK_Prior,	0},
+	{PAGEDOWNWINDOW, "PAGEDOWNWINDOW", XK_Next,	0},
+	{MRUWINDOW,	"MRUWINDOW",	XK_m,		0},
+	{NUMWINDOW(1),	"NUMWINDOW(1)",	XK_1,		0},
+	{NUMWINDOW(2),	"NUMWINDOW(2)",	XK_2,		0},
+	{NUMWINDOW(3),	"NUMWINDOW(3)",	XK_3,		0},
+	{NUMWINDOW(4),	"NUMWINDOW(4)",	XK_4,		0},
+	{NUMWINDOW(5),	"NUMWINDOW(5)",	XK_5,		0},
+	{NUMWINDOW(6),	"NUMWINDOW(6)",	XK_6,		0},
+	{NUMWINDOW(7),	"NUMWINDOW(7)",	XK_7,		0},
+	{NUMWINDOW(8),	"NUMWINDOW(8)",	XK_8,		0},
+	{NUMWINDOW(9),	"NUMWINDOW(9)",	XK_9,		0},
+	{-1,		NULL,		XK_VoidSymbol,	0},
+	{-1,		NULL,		XK_VoidSymbol,  0}
+};
+char *commandtostring(int command) {
+	int i;
+	for(i = 0; commandstring[i].string; i++)
+		if (commandstring[i].command == command)
+			return commandstring[i].string;
+	if (command >= NUMWINDOW(0)) {
+		if (commandstring[i + 1].string == NULL)
+			commandstring[i + 1].string = malloc(100);
+		sprintf(commandstring[i + 1].string, "NUMWINDOW(%d)",
+			command - NUMWINDOW(0));
+		return commandstring[i + 1].string;
+	}
+	return "ERROR: no such command";
+}
+int stringtocommand(char *string) {
+	int i;
+	char par;
+	for(i = 0; commandstring[i].string; i++)
+		if (! strcmp(commandstring[i].string, string))
+			return commandstring[i].command;
+	if (sscanf(string, "NUMWINDOW(%d%c", &i, &par) == 2 &&
+	    i >=0 && par == ')')
+		return NUMWINDOW(i);
+	return -1;
+}
+
+/*
+ * the trace records: a header of the magic string, the size of a record and
+ * the number of records, then the records
+ */
+#define TRACEMAGIC "IRWMTRC1"
+#define TRACECOMMAND 128	/* record of a command, not of an event */
+struct trace {
+	uint64_t time;		/* monotonic, in nanoseconds */
+	uint32_t serial;
+	int32_t type;		/* event type or TRACECOMMAND */
+	uint32_t window;
+	uint32_t other;		/* parent, sibling, atom... */
+	int32_t detail[2];	/* keycode, state, command, error... */
+};
+
+/*
+ * names of the events; the pseudo-types for errors and replies
+ */
+#define Error 0
+#define Reply 1
+char *eventname[LASTEvent] = {
+	"Error", "Reply", "KeyPress", "KeyRelease", "ButtonPress",
+	"ButtonRelease", "MotionNotify", "EnterNotify", "LeaveNotify",
+	"FocusIn", "FocusOut", "KeymapNotify", "Expose", "GraphicsExpose",
+	"NoExpose", "VisibilityNotify", "CreateNotify", "DestroyNotify",
+	"UnmapNotify", "MapNotify", "MapRequest", "ReparentNotify",
+	"ConfigureNotify", "ConfigureRequest", "GravityNotify",
+	"ResizeRequest", "CirculateNotify", "CirculateRequest",
+	"PropertyNotify", "SelectionClear", "SelectionRequest",
+	"SelectionNotify", "ColormapNotify", "ClientMessage", "MappingNotify",
+	"GenericEvent"
+};
@@ -0,0 +1,133 @@
+/*
+ * irwmtrace.c
+ *
+ * convert the binary trace of irwm into text, in the same format of the log
+ *
+ * the trace is written by irwm to the file given by -trace or by the "trace"
+ * line in irwmrc on LOGLIST, SIGUSR1, crash and exit; it contains the last
+ * events and commands irwm received
+ */
+
+#include "irwm.h"
+
+/*
+ * print a record
+ */
+void printrecord(struct trace *t, uint64_t start) {
+	double time;
+
+	time = (t->time - start) / 1000000000.0;
+
+	if (t->type == TRACECOMMAND) {
+		printf("COMMAND %s", commandtostring(t->detail[0]));
+		printf(" @%.6f\n", time);
+		return;
+	}
+
+	printf("[%u] ", t->type == Error ? 0 : t->serial);
+	if (t->type >= 0 && t->type < LASTEvent)
+		printf("%s", eventname[t->type]);
+	else
+		printf("Unexpected event, type=%d", t->type);
+	printf(" @%.6f\n", time);
+
+	switch (t->type) {
+	case Error:
+		printf("\terror=%d request=%d window=0x%x\n",
+			t->detail[0], t->detail[1], t->window);
+		break;
+	case MapRequest:
+	case CreateNotify:
+	case DestroyNotify:
+	case MapNotify:
+		printf("\t0x%x parent=0x%x", t->window, t->other);
+		if (t->type == CreateNotify && t->detail[0])
+			printf(" override_redirect");
+		printf("\n");
+		break;
+	case UnmapNotify:
+		printf("\t0x%x parent=0x%x %s\n", t->window, t->other,
+			t->detail[0] ? "synthetic" : "");
+		break;
+	case ReparentNotify:
+		printf("\t0x%x reparented to 0x%x\n", t->window, t->other);
+		break;
+	case ConfigureRequest:
+	case ConfigureNotify:
+		printf("\t0x%x width=%d height=%d above=0x%x\n",
+			t->window, t->detail[0], t->detail[1], t->other);
+		break;
+	case ClientMessage:
+		printf("\t0x%x atom=%u\n", t->window, t->other);
+		printf("\t\tdata: %d %d\n", t->detail[0], t->detail[1]);
+		break;
+	case KeyPress:
+	case KeyRelease:
+		printf("\t0x%x key=%d state=%d\n",
+			t->window, t->detail[0], t->detail[1]);
+		break;
+	case PropertyNotify:
+		printf("\t0x%x atom=%u\n", t->window, t->other);
+		break;
+	case Expose:
+		printf("\t0x%x count=%d\n", t->window, t->detail[0]);
+		break;
+	default:
+		printf("\t0x%x\n", t->window);
+	}
+}
+
+/*
+ * main
+ */
+int main(int argc, char *argv[]) {
+	FILE *in;
+	char magic[sizeof(TRACEMAGIC)];
+	uint32_t header[2];
+	struct trace t;
+	uint64_t start;
+	unsigned i;
+
+					/* arguments */
+
+	if (argc - 1 != 1 || ! strcmp(argv[1], "-h")) {
+		printf("convert the binary trace of irwm into text\n");
+		printf("usage:\n\tirwmtrace file\n");
+		exit(argc - 1 == 1 ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	in = ! strcmp(argv[1], "-") ? stdin : fopen(argv[1], "r");
+	if (in == NULL) {
+		perror(argv[1]);
+		exit(EXIT_FAILURE);
+	}
+
+					/* header */
+
+	if (fread(magic, strlen(TRACEMAGIC), 1, in) != 1 ||
+	    memcmp(magic, TRACEMAGIC, strlen(TRACEMAGIC)) ||
+	    fread(header, sizeof(header), 1, in) != 1) {
+		printf("not an irwm trace: %s\n", argv[1]);
+		exit(EXIT_FAILURE);
+	}
+	if (header[0] != sizeof(struct trace)) {
+		printf("unsupported record size: %u\n", header[0]);
+		exit(EXIT_FAILURE);
+	}
+
+					/* records */
+
+	start = 0;
+	for (i = 0; i < header[1]; i++) {
+		if (fread(&t, sizeof(t), 1, in) != 1) {
+			printf("truncated trace after %u records\n", i);
+			exit(EXIT_FAILURE);
+		}
+		if (i == 0)
+			start = t.time;
+		printrecord(&t, start);
+	}
+
+	fclose(in);
+	return EXIT_SUCCESS;
+}